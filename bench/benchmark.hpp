@@ -0,0 +1,98 @@
+/*
+Copyright (c) 2014 Andrey Goryachev <andrey.goryachev@gmail.com>
+Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+This file is part of Kora.
+
+Kora is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 3 of the License, or
+(at your option) any later version.
+
+Kora is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef KORA_BENCH_BENCHMARK_HPP
+#define KORA_BENCH_BENCHMARK_HPP
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+namespace kora { namespace bench {
+
+// Keeps the compiler from throwing away the results of the measured code.
+template<class T>
+inline
+void
+keep(const T& value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+// Runs the function repeatedly for at least the given time and returns nanoseconds per call.
+template<class F>
+double
+measure(F&& function, double min_seconds = 0.2) {
+    typedef std::chrono::steady_clock clock_type;
+
+    function();
+
+    size_t iterations = 1;
+
+    while (true) {
+        const auto start = clock_type::now();
+
+        for (size_t i = 0; i < iterations; ++i) {
+            function();
+        }
+
+        const std::chrono::duration<double> elapsed = clock_type::now() - start;
+
+        if (elapsed.count() >= min_seconds) {
+            return elapsed.count() * 1e9 / iterations;
+        }
+
+        iterations *= 2;
+    }
+}
+
+// Like measure(), but each call of the function gets a fresh argument made by setup(),
+// and only the function is timed. Slow setup is allowed to take at most ten times as long as the measurement.
+template<class Setup, class F>
+double
+measure_prepared(Setup&& setup, F&& function, double min_seconds = 0.2) {
+    typedef std::chrono::steady_clock clock_type;
+
+    const auto deadline = clock_type::now() + std::chrono::duration<double>(10 * min_seconds);
+
+    std::chrono::duration<double> elapsed(0);
+    size_t iterations = 0;
+
+    while (elapsed.count() < min_seconds && (iterations == 0 || clock_type::now() < deadline)) {
+        auto argument = setup();
+
+        const auto start = clock_type::now();
+        function(argument);
+        elapsed += clock_type::now() - start;
+
+        ++iterations;
+    }
+
+    return elapsed.count() * 1e9 / iterations;
+}
+
+inline
+void
+report(const std::string& name, double nanoseconds) {
+    std::printf("%-48s %12.1f ns\n", name.c_str(), nanoseconds);
+}
+
+}} // namespace kora::bench
+
+#endif
@@ -0,0 +1,175 @@
+/*
+Copyright (c) 2014 Andrey Goryachev <andrey.goryachev@gmail.com>
+Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+This file is part of Kora.
+
+Kora is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 3 of the License, or
+(at your option) any later version.
+
+Kora is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Compares building dynamic_t from lvalue and rvalue standard containers,
+// and building nested values from temporary containers and in place.
+
+#include "benchmark.hpp"
+
+#include "kora/dynamic.hpp"
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace kora;
+
+namespace {
+
+std::string
+make_string(size_t i) {
+    return "a string which doesn't fit inline, number " + std::to_string(i);
+}
+
+std::vector<std::string>
+make_strings() {
+    std::vector<std::string> result;
+
+    for (size_t i = 0; i < 10000; ++i) {
+        result.push_back(make_string(i));
+    }
+
+    return result;
+}
+
+std::vector<dynamic_t>
+make_values() {
+    std::vector<dynamic_t> result;
+
+    for (size_t i = 0; i < 10000; ++i) {
+        result.push_back(dynamic_t::object_t({{"id", i}, {"name", make_string(i)}}));
+    }
+
+    return result;
+}
+
+std::map<std::string, std::vector<std::string>>
+make_map() {
+    std::map<std::string, std::vector<std::string>> result;
+
+    for (size_t i = 0; i < 1000; ++i) {
+        result["key-" + std::to_string(i)] = std::vector<std::string>(10, make_string(i));
+    }
+
+    return result;
+}
+
+std::unordered_map<std::string, std::string>
+make_unordered_map() {
+    std::unordered_map<std::string, std::string> result;
+
+    for (size_t i = 0; i < 10000; ++i) {
+        result["key-" + std::to_string(i)] = make_string(i);
+    }
+
+    return result;
+}
+
+// The resulting value is destroyed after the measurement along with the container.
+template<class Container>
+struct arguments_t {
+    Container container;
+    dynamic_t value;
+};
+
+template<class Container>
+void
+run(const std::string& name, Container (*make)()) {
+    auto setup = [make]() -> arguments_t<Container> {
+        arguments_t<Container> result = { make(), dynamic_t() };
+        return result;
+    };
+
+    const double copy_time = bench::measure_prepared(setup, [](arguments_t<Container>& arguments) {
+        arguments.value = dynamic_t(arguments.container);
+    });
+
+    const double move_time = bench::measure_prepared(setup, [](arguments_t<Container>& arguments) {
+        arguments.value = dynamic_t(std::move(arguments.container));
+    });
+
+    bench::report(name + ": copy", copy_time);
+    bench::report(name + ": move", move_time);
+}
+
+// Builds a response of 10000 records with nested arrays.
+void
+build_with_temporaries(dynamic_t& response) {
+    dynamic_t::array_t records;
+    records.reserve(10000);
+
+    for (size_t i = 0; i < 10000; ++i) {
+        dynamic_t::array_t tags;
+        tags.reserve(2);
+        tags.emplace_back("first");
+        tags.emplace_back("second");
+
+        dynamic_t::object_t record;
+        record.reserve(3);
+        record["id"] = i;
+        record["name"] = "record";
+        record["tags"] = std::move(tags);
+
+        records.emplace_back(std::move(record));
+    }
+
+    response = std::move(records);
+}
+
+void
+build_in_place(dynamic_t& response) {
+    dynamic_t::array_t& records = response.emplace_array(10000);
+
+    for (size_t i = 0; i < 10000; ++i) {
+        records.emplace_back();
+        dynamic_t::object_t& record = records.back().emplace_object(3);
+        record["id"] = i;
+        record["name"] = "record";
+
+        dynamic_t::array_t& tags = record["tags"].emplace_array(2);
+        tags.emplace_back("first");
+        tags.emplace_back("second");
+    }
+}
+
+} // namespace
+
+int
+main() {
+    run("10000 strings", &make_strings);
+    run("10000 dynamic_t objects", &make_values);
+    run("1000 keys to 10 strings", &make_map);
+    run("10000 keys to strings, unordered", &make_unordered_map);
+
+    bench::report("10000 records: temporaries", bench::measure([]() {
+        dynamic_t response;
+        build_with_temporaries(response);
+        bench::keep(response);
+    }));
+
+    bench::report("10000 records: in place", bench::measure([]() {
+        dynamic_t response;
+        build_in_place(response);
+        bench::keep(response);
+    }));
+
+    return 0;
+}
@@ -0,0 +1,199 @@
+/*
+Copyright (c) 2014 Andrey Goryachev <andrey.goryachev@gmail.com>
+Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+This file is part of Kora.
+
+Kora is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 3 of the License, or
+(at your option) any later version.
+
+Kora is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Compares writing of number-heavy JSON with the formatting of doubles by rapidjson and by snprintf,
+// and checks that the written doubles are read back exactly.
+
+#include "benchmark.hpp"
+
+#include "kora/dynamic.hpp"
+
+#include <rapidjson/writer.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+
+using namespace kora;
+
+namespace {
+
+const size_t array_size = 100000;
+
+// Values of a metric with a few decimal places.
+dynamic_t::array_t
+make_metrics() {
+    std::mt19937_64 generator(1);
+    std::uniform_int_distribution<int> distribution(0, 10000000);
+
+    dynamic_t::array_t result;
+
+    for (size_t i = 0; i < array_size; ++i) {
+        result.emplace_back(distribution(generator) / 1000.0);
+    }
+
+    return result;
+}
+
+// Latitudes and longitudes.
+dynamic_t::array_t
+make_coordinates() {
+    std::mt19937_64 generator(2);
+    std::uniform_real_distribution<double> distribution(-180, 180);
+
+    dynamic_t::array_t result;
+
+    for (size_t i = 0; i < array_size; ++i) {
+        result.emplace_back(distribution(generator));
+    }
+
+    return result;
+}
+
+// Any finite doubles.
+dynamic_t::array_t
+make_random_bits() {
+    std::mt19937_64 generator(3);
+
+    dynamic_t::array_t result;
+
+    while (result.size() < array_size) {
+        const uint64_t bits = generator();
+
+        double number;
+        std::memcpy(&number, &bits, sizeof(number));
+
+        if (std::isfinite(number)) {
+            result.emplace_back(number);
+        }
+    }
+
+    return result;
+}
+
+// Output stream of rapidjson appending to a string.
+struct string_stream_t {
+    void
+    Put(char c) {
+        data.push_back(c);
+    }
+
+    void
+    Flush() { }
+
+    std::string data;
+};
+
+// The way the doubles were written before.
+std::string
+write_with_rapidjson(const dynamic_t::array_t& numbers) {
+    string_stream_t stream;
+    rapidjson::Writer<string_stream_t> writer(stream);
+
+    writer.StartArray();
+
+    for (auto it = numbers.begin(); it != numbers.end(); ++it) {
+        writer.Double(it->as_double());
+    }
+
+    writer.EndArray();
+
+    return stream.data;
+}
+
+// The usual way to write doubles exactly without a special algorithm.
+std::string
+write_with_snprintf(const dynamic_t::array_t& numbers) {
+    std::string result = "[";
+
+    for (auto it = numbers.begin(); it != numbers.end(); ++it) {
+        char buffer[32];
+        const int size = std::snprintf(buffer, sizeof(buffer), "%.17g", it->as_double());
+
+        if (it != numbers.begin()) {
+            result += ',';
+        }
+
+        result.append(buffer, size);
+    }
+
+    result += ']';
+
+    return result;
+}
+
+// Returns the number of the doubles which aren't read back exactly.
+size_t
+count_inexact(const dynamic_t::array_t& numbers) {
+    const dynamic_t parsed = dynamic::read_json(to_json(numbers));
+
+    size_t result = 0;
+
+    for (size_t i = 0; i < numbers.size(); ++i) {
+        const double expected = numbers[i].as_double();
+        const double actual = parsed.as_array()[i].as_double();
+
+        if (std::memcmp(&expected, &actual, sizeof(expected)) != 0) {
+            ++result;
+        }
+    }
+
+    return result;
+}
+
+} // namespace
+
+int
+main() {
+    const std::pair<std::string, dynamic_t::array_t> payloads[] = {
+        std::make_pair("metrics", make_metrics()),
+        std::make_pair("coordinates", make_coordinates()),
+        std::make_pair("random bits", make_random_bits())
+    };
+
+    size_t inexact = 0;
+
+    for (size_t i = 0; i < sizeof(payloads) / sizeof(payloads[0]); ++i) {
+        const std::string& name = payloads[i].first;
+        const dynamic_t::array_t& numbers = payloads[i].second;
+
+        bench::report("100000 " + name + ": to_json", bench::measure([&numbers]() {
+            bench::keep(to_json(numbers).size());
+        }));
+
+        bench::report("100000 " + name + ": rapidjson", bench::measure([&numbers]() {
+            bench::keep(write_with_rapidjson(numbers).size());
+        }));
+
+        bench::report("100000 " + name + ": snprintf", bench::measure([&numbers]() {
+            bench::keep(write_with_snprintf(numbers).size());
+        }));
+
+        std::cout << "100000 " << name << ": " << to_json(numbers).size() << " bytes, "
+                  << count_inexact(numbers) << " read back inexactly" << std::endl;
+
+        inexact += count_inexact(numbers);
+    }
+
+    return inexact == 0 ? 0 : 1;
+}
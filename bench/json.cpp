@@ -0,0 +1,188 @@
+/*
+Copyright (c) 2014 Andrey Goryachev <andrey.goryachev@gmail.com>
+Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+This file is part of Kora.
+
+Kora is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 3 of the License, or
+(at your option) any later version.
+
+Kora is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Compares reading of a record stream into a tree, by events, with a projection and lazily,
+// and writing of responses with a large constant part as a tree and as raw JSON.
+
+#include "benchmark.hpp"
+
+#include "kora/dynamic.hpp"
+
+#include <string>
+
+using namespace kora;
+
+namespace {
+
+std::string
+make_records() {
+    dynamic_t::array_t records;
+
+    for (size_t i = 0; i < 10000; ++i) {
+        dynamic_t::object_t record;
+        record["id"] = i;
+        record["name"] = "record name which doesn't fit inline " + std::to_string(i);
+        record["tags"] = dynamic_t::array_t(3, "tag");
+        record["owner"] = dynamic_t::object_t({{"id", 1}, {"group", 2}});
+
+        records.push_back(std::move(record));
+    }
+
+    return to_json(records);
+}
+
+// Sums the top-level "id" fields of the records.
+class id_sum_handler_t:
+    public json_handler_t
+{
+public:
+    id_sum_handler_t() :
+        sum(0),
+        m_depth(0),
+        m_id_expected(false)
+    { }
+
+    void
+    unsigned_integer(dynamic_t::uint_t value) {
+        if (m_id_expected) {
+            sum += value;
+        }
+
+        m_id_expected = false;
+    }
+
+    void
+    key(const string_view_t& value) {
+        m_id_expected = m_depth == 2 && value == "id";
+    }
+
+    void
+    start_array() {
+        ++m_depth;
+    }
+
+    void
+    finish_array(size_t) {
+        --m_depth;
+    }
+
+    void
+    start_object() {
+        ++m_depth;
+        m_id_expected = false;
+    }
+
+    void
+    finish_object(size_t) {
+        --m_depth;
+    }
+
+    void
+    string(const string_view_t&) {
+        m_id_expected = false;
+    }
+
+    dynamic_t::uint_t sum;
+
+private:
+    size_t m_depth;
+    bool m_id_expected;
+};
+
+} // namespace
+
+int
+main() {
+    const std::string json = make_records();
+
+    json_parser_t parser;
+
+    bench::report("10000 records: tree", bench::measure([&json, &parser]() {
+        const dynamic_t records = parser.parse(json);
+        dynamic_t::uint_t sum = 0;
+
+        for (auto it = records.as_array().begin(); it != records.as_array().end(); ++it) {
+            sum += it->as_object().at("id").as_uint();
+        }
+
+        bench::keep(sum);
+    }));
+
+    bench::report("10000 records: events", bench::measure([&json, &parser]() {
+        id_sum_handler_t handler;
+        parser.parse(json.data(), json.size(), handler);
+        bench::keep(handler.sum);
+    }));
+
+    const json_projection_t projection({"[*].id"});
+
+    bench::report("10000 records: projection", bench::measure([&json, &parser, &projection]() {
+        const dynamic_t records = parser.parse(json.data(), json.size(), projection);
+        dynamic_t::uint_t sum = 0;
+
+        for (auto it = records.as_array().begin(); it != records.as_array().end(); ++it) {
+            sum += it->as_object().at("id").as_uint();
+        }
+
+        bench::keep(sum);
+    }));
+
+    // The nested containers of the records are kept as text.
+    bench::report("10000 records: lazy", bench::measure([&json]() {
+        const dynamic_t records = dynamic::read_lazy_json(json, 2);
+        dynamic_t::uint_t sum = 0;
+
+        for (auto it = records.as_array().begin(); it != records.as_array().end(); ++it) {
+            sum += it->as_object().at("id").as_uint();
+        }
+
+        bench::keep(sum);
+    }));
+
+    bench::report("10000 records: read and write, tree", bench::measure([&json, &parser]() {
+        bench::keep(to_json(parser.parse(json)).size());
+    }));
+
+    bench::report("10000 records: read and write, lazy", bench::measure([&json]() {
+        bench::keep(to_json(dynamic::read_lazy_json(json, 2)).size());
+    }));
+
+    // Only the id of the response changes.
+    const dynamic_t catalog = dynamic::read_json(json);
+    const dynamic_t raw_catalog = dynamic::raw_json_t(json);
+
+    bench::report("response with 10000 records: tree", bench::measure([&catalog]() {
+        dynamic_t::object_t response;
+        response["id"] = 1;
+        response["catalog"] = catalog;
+
+        bench::keep(to_json(response).size());
+    }));
+
+    bench::report("response with 10000 records: raw", bench::measure([&raw_catalog]() {
+        dynamic_t::object_t response;
+        response["id"] = 1;
+        response["catalog"] = raw_catalog;
+
+        bench::keep(to_json(response).size());
+    }));
+
+    return 0;
+}
@@ -0,0 +1,152 @@
+/*
+Copyright (c) 2014 Andrey Goryachev <andrey.goryachev@gmail.com>
+Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+This file is part of Kora.
+
+Kora is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 3 of the License, or
+(at your option) any later version.
+
+Kora is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Compares dynamic_t::object_t with std::map<std::string, dynamic_t> on objects of typical and large sizes.
+
+#include "benchmark.hpp"
+
+#include "kora/dynamic.hpp"
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace kora;
+
+namespace {
+
+std::vector<std::string>
+make_keys(size_t count) {
+    std::vector<std::string> keys;
+
+    for (size_t i = 0; i < count; ++i) {
+        keys.push_back("key-" + std::to_string(i));
+    }
+
+    // Real documents aren't sorted by key.
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(42));
+
+    return keys;
+}
+
+template<class Object>
+void
+run(const std::string& name, size_t size) {
+    const std::vector<std::string> keys = make_keys(size);
+
+    const double build_time = bench::measure([&keys]() {
+        Object object;
+
+        for (auto it = keys.begin(); it != keys.end(); ++it) {
+            object[*it] = 1;
+        }
+
+        bench::keep(object);
+    });
+
+    std::vector<std::string> sorted_keys = keys;
+    std::sort(sorted_keys.begin(), sorted_keys.end());
+
+    // JSON written by kora and objects converted from std::map have sorted keys.
+    const double sorted_build_time = bench::measure([&sorted_keys]() {
+        Object object;
+
+        for (auto it = sorted_keys.begin(); it != sorted_keys.end(); ++it) {
+            object[*it] = 1;
+        }
+
+        bench::keep(object);
+    });
+
+    std::vector<std::pair<std::string, dynamic_t>> items;
+
+    for (auto it = keys.begin(); it != keys.end(); ++it) {
+        items.push_back(std::make_pair(*it, dynamic_t(1)));
+    }
+
+    const double range_build_time = bench::measure([&items]() {
+        Object object(items.begin(), items.end());
+        bench::keep(object);
+    });
+
+    const Object object(items.begin(), items.end());
+
+    const double lookup_time = bench::measure([&keys, &object]() {
+        size_t found = 0;
+
+        for (auto it = keys.begin(); it != keys.end(); ++it) {
+            found += object.find(*it) != object.end();
+        }
+
+        bench::keep(found);
+    });
+
+    const double iteration_time = bench::measure([&object]() {
+        size_t strings = 0;
+
+        for (auto it = object.begin(); it != object.end(); ++it) {
+            strings += it->second.is_string();
+        }
+
+        bench::keep(strings);
+    });
+
+    // Lookups in many objects don't fit into the cache, like in real documents.
+    std::vector<Object> objects(std::min<size_t>(10000, std::max<size_t>(2, 1000000 / size)), object);
+    size_t next = 0;
+
+    const double cold_lookup_time = bench::measure([&keys, &objects, &next]() {
+        const Object& object = objects[next];
+        next = (next + 1) % objects.size();
+
+        size_t found = 0;
+
+        for (auto it = keys.begin(); it != keys.end(); ++it) {
+            found += object.find(*it) != object.end();
+        }
+
+        bench::keep(found);
+    });
+
+    const std::string prefix = name + " " + std::to_string(size) + " keys: ";
+
+    bench::report(prefix + "build by key", build_time);
+    bench::report(prefix + "build by sorted key", sorted_build_time);
+    bench::report(prefix + "build from a range", range_build_time);
+    bench::report(prefix + "lookup of every key", lookup_time);
+    bench::report(prefix + "lookup of every key, " + std::to_string(objects.size()) + " objects", cold_lookup_time);
+    bench::report(prefix + "iteration", iteration_time);
+}
+
+} // namespace
+
+int
+main() {
+    const size_t sizes[] = {5, 10, 20, 100, 1000, 100000};
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+        run<dynamic_t::object_t>("object_t", sizes[i]);
+        run<std::map<std::string, dynamic_t>>("std::map", sizes[i]);
+    }
+
+    return 0;
+}
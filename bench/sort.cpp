@@ -0,0 +1,107 @@
+/*
+Copyright (c) 2014 Andrey Goryachev <andrey.goryachev@gmail.com>
+Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+This file is part of Kora.
+
+Kora is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 3 of the License, or
+(at your option) any later version.
+
+Kora is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Measures sorting and shuffling of large arrays, which mostly swap elements.
+
+#include "benchmark.hpp"
+
+#include "kora/dynamic.hpp"
+
+#include <algorithm>
+#include <random>
+#include <string>
+
+using namespace kora;
+
+namespace {
+
+const size_t array_size = 100000;
+
+dynamic_t::array_t
+make_numbers() {
+    dynamic_t::array_t result;
+    result.reserve(array_size);
+
+    for (size_t i = 0; i < array_size; ++i) {
+        result.emplace_back(static_cast<dynamic_t::int_t>(i));
+    }
+
+    std::shuffle(result.begin(), result.end(), std::mt19937(1));
+
+    return result;
+}
+
+dynamic_t::array_t
+make_strings() {
+    dynamic_t::array_t result;
+    result.reserve(array_size);
+
+    for (size_t i = 0; i < array_size; ++i) {
+        result.emplace_back("a string which doesn't fit inline, number " + std::to_string(i));
+    }
+
+    std::shuffle(result.begin(), result.end(), std::mt19937(1));
+
+    return result;
+}
+
+bool
+less_number(const dynamic_t& left, const dynamic_t& right) {
+    return left.as_int() < right.as_int();
+}
+
+bool
+less_string(const dynamic_t& left, const dynamic_t& right) {
+    const string_view_t left_view = left.as_string_view();
+    const string_view_t right_view = right.as_string_view();
+
+    return std::lexicographical_compare(left_view.begin(), left_view.end(), right_view.begin(), right_view.end());
+}
+
+void
+run(const std::string& name, dynamic_t::array_t (*make)(), bool (*less)(const dynamic_t&, const dynamic_t&)) {
+    const dynamic_t::array_t source = make();
+
+    auto setup = [&source]() -> dynamic_t::array_t {
+        return source;
+    };
+
+    bench::report(name + ": sort", bench::measure_prepared(setup, [less](dynamic_t::array_t& array) {
+        std::sort(array.begin(), array.end(), less);
+    }));
+
+    bench::report(name + ": shuffle", bench::measure_prepared(setup, [](dynamic_t::array_t& array) {
+        std::shuffle(array.begin(), array.end(), std::mt19937(2));
+    }));
+
+    bench::report(name + ": reverse", bench::measure_prepared(setup, [](dynamic_t::array_t& array) {
+        std::reverse(array.begin(), array.end());
+    }));
+}
+
+} // namespace
+
+int
+main() {
+    run("100000 numbers", &make_numbers, &less_number);
+    run("100000 strings", &make_strings, &less_string);
+
+    return 0;
+}
@@ -0,0 +1,151 @@
+/*
+Copyright (c) 2014 Andrey Goryachev <andrey.goryachev@gmail.com>
+Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+This file is part of Kora.
+
+Kora is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 3 of the License, or
+(at your option) any later version.
+
+Kora is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Measures destruction, copying, comparison and hashing of wide and deep trees.
+
+#include "benchmark.hpp"
+
+#include "kora/dynamic.hpp"
+
+#include <memory>
+#include <string>
+
+using namespace kora;
+
+namespace {
+
+// Array of records like the ones returned by a typical service.
+dynamic_t
+make_wide_tree() {
+    dynamic_t::array_t records;
+
+    for (size_t i = 0; i < 10000; ++i) {
+        dynamic_t::object_t record;
+        record["id"] = i;
+        record["name"] = "record name which doesn't fit inline " + std::to_string(i);
+        record["kind"] = "short";
+        record["tags"] = dynamic_t::array_t(3, 7);
+        record["owner"] = dynamic_t::object_t({{"id", 1}, {"group", 2}});
+
+        records.push_back(std::move(record));
+    }
+
+    return records;
+}
+
+// Chain of nested arrays.
+dynamic_t
+make_deep_tree(size_t depth) {
+    dynamic_t result = dynamic_t::array_t();
+
+    for (size_t i = 0; i < depth; ++i) {
+        dynamic_t::array_t array;
+        array.push_back(std::move(result));
+        array.push_back(i);
+
+        result = std::move(array);
+    }
+
+    return result;
+}
+
+// Changes the last scalar of the tree, which is compared last.
+void
+change_last_leaf(dynamic_t& tree) {
+    dynamic_t *value = &tree;
+
+    while (value->is_array() || value->is_object()) {
+        value = value->is_array() ? &value->as_array().back() : &(--value->as_object().end())->second;
+    }
+
+    *value = -1;
+}
+
+void
+run(const std::string& name, dynamic_t (*make)()) {
+    const double destruction_time = bench::measure_prepared(
+        [make]() {
+            return std::unique_ptr<dynamic_t>(new dynamic_t(make()));
+        },
+        [](std::unique_ptr<dynamic_t>& tree) {
+            tree.reset();
+        }
+    );
+
+    const dynamic_t tree = make();
+    const dynamic_t other = make();
+
+    const double comparison_time = bench::measure([&tree, &other]() {
+        bench::keep(tree == other);
+    });
+
+    // Hashes are saved in the trees, so each tree is hashed once.
+    const double hashing_time = bench::measure_prepared(make, [](dynamic_t& tree) {
+        bench::keep(hash_value(tree));
+    });
+
+    dynamic_t changed = make();
+    change_last_leaf(changed);
+
+    const double changed_comparison_time = bench::measure([&tree, &changed]() {
+        bench::keep(tree == changed);
+    });
+
+    // Saved hashes of the changed containers differ.
+    hash_value(tree);
+    hash_value(changed);
+
+    const double hashed_comparison_time = bench::measure([&tree, &changed]() {
+        bench::keep(tree == changed);
+    });
+
+    // Copies of documents are deep, unlike copies of values which share their containers.
+    document_t document;
+
+    const std::string json = to_json(tree);
+    dynamic::read_json(json.data(), json.size(), document);
+
+    const double document_copy_time = bench::measure([&document]() {
+        dynamic_t copy = document.root();
+        bench::keep(copy);
+    });
+
+    bench::report(name + ": destruction", destruction_time);
+    bench::report(name + ": comparison", comparison_time);
+    bench::report(name + ": hashing", hashing_time);
+    bench::report(name + ": comparison with a changed leaf", changed_comparison_time);
+    bench::report(name + ": same, hashed", hashed_comparison_time);
+    bench::report(name + ": copy of document", document_copy_time);
+}
+
+dynamic_t
+make_deep_tree() {
+    return make_deep_tree(1000);
+}
+
+} // namespace
+
+int
+main() {
+    run("10000 records", &make_wide_tree);
+    run("1000 levels", &make_deep_tree);
+
+    return 0;
+}
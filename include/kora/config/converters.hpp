@@ -97,7 +97,7 @@ struct converter<std::chrono::duration<Rep, Period>> {
         }
 
         if (from.is_string()) {
-            const auto &string = from.as_string();
+            const auto string = from.as_string_view();
             size_t pos = 0;
             for (; pos != string.size(); ++pos) {
                 if (!std::isdigit(string[pos])) {
@@ -109,7 +109,7 @@ struct converter<std::chrono::duration<Rep, Period>> {
                 return false;
             }
 
-            const auto &suffix = string.substr(pos);
+            const string_view_t suffix(string.data() + pos, string.size() - pos);
 
             if (suffix == "ns" || suffix == "us" || suffix == "ms" || suffix == "s"
                     || suffix == "m" || suffix == "h") {
@@ -85,6 +85,9 @@ public:
     operator=(const config_parser_t &other);
 
     /*! Parse config from a JSON object stored in a file.
+     *
+     * Regular files are mapped into memory and parsed in place.
+     * Other files (e.g. named pipes) are read as streams.
      *
      * \warning Invalidates all config_t objects produced earlier.
      *
@@ -94,7 +97,7 @@ public:
      * \throws std::runtime_error If the method failed to open the file.
      * \throws std::bad_alloc
      *
-     * \sa parse(std::istream&)
+     * \sa parse(const char*, size_t)
      */
     KORA_API
     config_t
@@ -114,6 +117,20 @@ public:
     config_t
     parse(std::istream &stream);
 
+    /*! Parse config from a JSON object stored in memory.
+     *
+     * \warning Invalidates all config_t objects produced earlier.
+     *
+     * \param data Pointer to the JSON object.
+     * \param size Size of the buffer. The buffer is not required to be null-terminated.
+     * \returns \p root() after new configuration is parsed and stored in the parser.
+     * \throws config_parser_error_t If the buffer contains anything but a valid JSON object.
+     * \throws std::bad_alloc
+     */
+    KORA_API
+    config_t
+    parse(const char *data, size_t size);
+
     /*! Get config object.
      *
      * \returns config_t with path "<root>" and recently loaded dynamic object.
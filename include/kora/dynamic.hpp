@@ -23,6 +23,7 @@
 
 #include "kora/dynamic/constructors.hpp"
 #include "kora/dynamic/converters.hpp"
+#include "kora/dynamic/document.hpp"
 #include "kora/dynamic/dynamic.hpp"
 #include "kora/dynamic/error.hpp"
 #include "kora/dynamic/json.hpp"
@@ -28,6 +28,8 @@ KORA_PUSH_VISIBLE
 #include <boost/numeric/conversion/cast.hpp>
 KORA_POP_VISIBILITY
 
+#include <memory>
+#include <string>
 #include <tuple>
 #include <type_traits>
 #include <utility>
@@ -152,8 +154,7 @@ struct constructor<char[N]> {
     static inline
     void
     convert(const char* from, dynamic_t& to) {
-        dynamic_t::string_t buffer(from, N - 1);
-        to = std::move(buffer);
+        to = string_view_t(from, N - 1);
     }
 };
 
@@ -167,8 +168,65 @@ struct constructor<const char*> {
     static inline
     void
     convert(const char* from, dynamic_t& to) {
-        dynamic_t::string_t buffer(from);
-        to = std::move(buffer);
+        to = string_view_t(from);
+    }
+};
+
+/*! Array or object already serialized to JSON.
+ *
+ * dynamic_t created from it is written by write_json() and to_json() by copying the text, so a large part
+ * of the output which rarely changes may be serialized once and put into every tree.
+ * The text is checked once by the constructor, and it's parsed only if the value is accessed like an array or object.
+ * Copies of the fragment and of the values created from it share the text.
+ *
+ * \sa dynamic_t::from_json_text()
+ */
+class raw_json_t {
+public:
+    //! \throws json_parsing_error_t If the text isn't a single array or object.
+    //! \throws std::bad_alloc
+    explicit
+    raw_json_t(std::string json) :
+        m_json(std::make_shared<const std::string>(std::move(json))),
+        m_value(dynamic_t::from_json_text(m_json, *m_json))
+    { }
+
+    //! Shares the text with other fragments. \p json must not be null.
+    //! \throws json_parsing_error_t If the text isn't a single array or object.
+    //! \throws std::bad_alloc
+    explicit
+    raw_json_t(std::shared_ptr<const std::string> json) :
+        m_json(std::move(json)),
+        m_value(dynamic_t::from_json_text(m_json, *m_json))
+    { }
+
+    const std::shared_ptr<const std::string>&
+    json() const KORA_NOEXCEPT {
+        return m_json;
+    }
+
+    //! \returns The value holding the checked text.
+    const dynamic_t&
+    value() const KORA_NOEXCEPT {
+        return m_value;
+    }
+
+private:
+    std::shared_ptr<const std::string> m_json;
+    dynamic_t m_value;
+};
+
+//! \brief Converts raw_json_t to dynamic_t.
+template<>
+struct constructor<raw_json_t> {
+    static const bool enable = true;
+
+    //! \post <tt>to.json_text()</tt> refers to the text of \p from without the surrounding whitespace.
+    //! \throws std::bad_alloc
+    static inline
+    void
+    convert(const raw_json_t& from, dynamic_t& to) {
+        to = from.value();
     }
 };
 
@@ -193,6 +251,43 @@ struct constructor<std::vector<T>> {
 
         to = std::move(buffer);
     }
+
+    //! Moves the elements instead of copying them.
+    //! \throws std::bad_alloc
+    //! \throws Any exceptions thrown by <tt>dynamic_t(std::declval<T&&>())</tt>
+    static inline
+    void
+    convert(std::vector<T>&& from, dynamic_t& to) {
+        dynamic_t::array_t buffer;
+        buffer.reserve(from.size());
+
+        for (auto it = from.begin(); it != from.end(); ++it) {
+            buffer.emplace_back(std::move(*it));
+        }
+
+        to = std::move(buffer);
+    }
+};
+
+//! \brief Converts std::vector<dynamic_t> to dynamic_t.
+template<>
+struct constructor<std::vector<dynamic_t>> {
+    static const bool enable = true;
+
+    //! \post <tt>to.is_array() == true && to.as_array() == from</tt>
+    //! \throws std::bad_alloc
+    static inline
+    void
+    convert(const std::vector<dynamic_t>& from, dynamic_t& to) {
+        to = dynamic_t::array_t(from);
+    }
+
+    //! Takes the buffer of \p from, so the elements aren't copied or moved.
+    static inline
+    void
+    convert(std::vector<dynamic_t>&& from, dynamic_t& to) {
+        to = std::move(from);
+    }
 };
 
 //! \brief Converts std::tuple to dynamic_t.
@@ -253,6 +348,8 @@ struct constructor<std::map<dynamic_t::string_t, dynamic_t>> {
     //! \post <tt>to.is_object() == true && to.as_object().size() == from.size()</tt>
     //! \post For all <tt>std::string key; from.count(key) == to.as_object().count(key)</tt>
     //! \post For all <tt>std::string key; from.count(key) > 0 ==> to.as_object()[key] == from[key]</tt>
+    //! If \p from is an rvalue, the values are moved. The keys are copied, because they are constant in the map,
+    //! and object_t stores its items in a vector, so the nodes of the map can't be taken over.
     //! \throws std::bad_alloc
     //! \throws Any exceptions thrown by dynamic_t copy constructor.
     template<class Object>
@@ -277,9 +374,27 @@ struct constructor<std::map<std::string, T>> {
     void
     convert(const std::map<std::string, T>& from, dynamic_t& to) {
         dynamic_t::object_t buffer;
+        buffer.reserve(from.size());
 
+        // The keys are sorted, so each of them is appended.
         for (auto it = from.begin(); it != from.end(); ++it) {
-            buffer.insert(dynamic_t::object_t::value_type(it->first, it->second));
+            buffer.insert(buffer.end(), dynamic_t::object_t::value_type(it->first, it->second));
+        }
+
+        to = std::move(buffer);
+    }
+
+    //! Moves the values instead of copying them. The keys are copied, because they are constant in the map.
+    //! \throws std::bad_alloc
+    //! \throws Any exceptions thrown by <tt>dynamic_t(std::declval<T&&>())</tt>
+    static inline
+    void
+    convert(std::map<std::string, T>&& from, dynamic_t& to) {
+        dynamic_t::object_t buffer;
+        buffer.reserve(from.size());
+
+        for (auto it = from.begin(); it != from.end(); ++it) {
+            buffer.insert(buffer.end(), dynamic_t::object_t::value_type(it->first, std::move(it->second)));
         }
 
         to = std::move(buffer);
@@ -300,6 +415,7 @@ struct constructor<std::unordered_map<std::string, T>> {
     void
     convert(const std::unordered_map<std::string, T>& from, dynamic_t& to) {
         dynamic_t::object_t buffer;
+        buffer.reserve(from.size());
 
         for (auto it = from.begin(); it != from.end(); ++it) {
             buffer.insert(dynamic_t::object_t::value_type(it->first, it->second));
@@ -307,6 +423,22 @@ struct constructor<std::unordered_map<std::string, T>> {
 
         to = std::move(buffer);
     }
+
+    //! Moves the values instead of copying them. The keys are copied, because they are constant in the map.
+    //! \throws std::bad_alloc
+    //! \throws Any exceptions thrown by <tt>dynamic_t(std::declval<T&&>())</tt>
+    static inline
+    void
+    convert(std::unordered_map<std::string, T>&& from, dynamic_t& to) {
+        dynamic_t::object_t buffer;
+        buffer.reserve(from.size());
+
+        for (auto it = from.begin(); it != from.end(); ++it) {
+            buffer.insert(dynamic_t::object_t::value_type(it->first, std::move(it->second)));
+        }
+
+        to = std::move(buffer);
+    }
 };
 
 }} // namespace kora::dynamic
@@ -201,7 +201,7 @@ struct converter<
 //! \brief Converts dynamic_t to std::string and to dynamic_t::string_t (they are the same now).
 template<>
 struct converter<std::string> {
-    typedef const std::string& result_type;
+    typedef std::string result_type;
 
     //! Doesn't call any controller's traverse methods.\n
     //! Fails with \p expected_string_t error if <tt>!from.is_string()</tt>.\n
@@ -232,13 +232,13 @@ struct converter<const char*> {
 
     //! Doesn't call any controller's traverse methods.\n
     //! Fails with \p expected_string_t error if <tt>!from.is_string()</tt>.\n
-    //! \returns <tt>from.as_string().c_str()</tt>
+    //! \returns <tt>from.as_string_view().data()</tt>
     template<class Controller>
     static inline
     result_type
     convert(const dynamic_t& from, Controller& controller) {
         if (from.is_string()) {
-            return from.as_string().c_str();
+            return from.as_string_view().data();
         } else {
             controller.fail(expected_string_t(), from);
         }
@@ -547,17 +547,19 @@ struct converter<dynamic_t::object_t> {
 //! \brief Converts dynamic_t to std::map<std::string, dynamic_t>.
 template<>
 struct converter<std::map<std::string, dynamic_t>> {
-    typedef const std::map<std::string, dynamic_t>& result_type;
+    typedef std::map<std::string, dynamic_t> result_type;
 
     //! Doesn't call any controller's traverse methods.\n
     //! Fails with \p expected_object_t error if <tt>!from.is_object()</tt>.\n
-    //! \returns <tt>from.as_object()</tt>
+    //! \returns Copy of the items of <tt>from.as_object()</tt>
+    //! \throws std::bad_alloc
     template<class Controller>
     static inline
     result_type
     convert(const dynamic_t& from, Controller& controller) {
         if (from.is_object()) {
-            return from.as_object();
+            const dynamic_t::object_t& object = from.as_object();
+            return result_type(object.begin(), object.end());
         } else {
             controller.fail(expected_object_t(), from);
         }
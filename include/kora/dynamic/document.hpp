@@ -0,0 +1,125 @@
+/*
+    Copyright (c) 2013-2014 Andrey Goryachev <andrey.goryachev@gmail.com>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Kora.
+
+    Kora is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Kora is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef KORA_DYNAMIC_DOCUMENT_HPP
+#define KORA_DYNAMIC_DOCUMENT_HPP
+
+#include "kora/dynamic/dynamic.hpp"
+
+#include <memory>
+
+namespace kora {
+
+/*! Tree of dynamic objects allocated in a bump arena.
+ *
+ * Long strings and the arrays and objects created by the document are placed one after another
+ * in large blocks of memory. Building a tree this way needs a few allocations instead of one per value,
+ * the values lie close to each other in memory, and the blocks are released all at once.
+ * The elements of arrays and objects are still stored by their containers.
+ *
+ * The values created by the document may be moved anywhere, but they refer to its memory,
+ * so they must be destroyed before clear() or the destruction of the document. It applies to the root too:
+ * <tt>dynamic_t value = std::move(document.root())</tt> still refers to the document.
+ * Copies of the values don't refer to the document, so a tree which has to outlive the document must be copied. But arrays and objects created outside of the document
+ * are shared by copies, so they shouldn't contain values of the document if the copies are to outlive it.
+ *
+ * With string interning enabled, equal long string values created by the document share the same memory.
+ * It saves memory on record-oriented data, where the same values are repeated in every record.
+ * Short strings are stored inline, so there is nothing to share. Keys aren't interned: object_t stores them
+ * as std::string, so read_json() doesn't create them in the document.
+ *
+ * \warning The document isn't thread-safe.
+ */
+class document_t {
+    KORA_NONCOPYABLE(document_t)
+
+public:
+    //! \throws std::bad_alloc
+    KORA_API
+    document_t();
+
+    KORA_API
+    ~document_t() KORA_NOEXCEPT;
+
+    //! \returns The root value of the document. It's null in a new document.
+    KORA_API
+    dynamic_t&
+    root() KORA_NOEXCEPT;
+
+    KORA_API
+    const dynamic_t&
+    root() const KORA_NOEXCEPT;
+
+    /*! Creates string value stored in the document.
+     * Short strings are stored inline in the resulting object and don't use the document.
+     * If string interning is enabled, a previously created equal string is reused.
+     * \throws std::bad_alloc
+     */
+    KORA_API
+    dynamic_t
+    make_string(const string_view_t& value);
+
+    /*! Creates array stored in the document.
+     * \throws std::bad_alloc
+     */
+    KORA_API
+    dynamic_t
+    make_array(dynamic_t::array_t value = dynamic_t::array_t());
+
+    /*! Creates object stored in the document.
+     * \throws std::bad_alloc
+     */
+    KORA_API
+    dynamic_t
+    make_object(dynamic_t::object_t value = dynamic_t::object_t());
+
+    /*! Enables or disables string interning. It's disabled by default.
+     * The strings created before enabling the interning aren't shared.
+     */
+    KORA_API
+    void
+    set_string_interning(bool enabled) KORA_NOEXCEPT;
+
+    KORA_API
+    bool
+    string_interning() const KORA_NOEXCEPT;
+
+    /*! Destroys the root and releases the memory of the document.
+     *
+     * The largest block is kept to build the next tree in it. String interning stays enabled if it was.
+     */
+    KORA_API
+    void
+    clear() KORA_NOEXCEPT;
+
+    //! \returns Total size of the blocks owned by the document.
+    KORA_API
+    size_t
+    capacity() const KORA_NOEXCEPT;
+
+private:
+    class implementation_t;
+
+    std::unique_ptr<implementation_t> m_impl;
+};
+
+} // namespace kora
+
+#endif
@@ -21,19 +21,25 @@
 #ifndef KORA_DYNAMIC_DYNAMIC_HPP
 #define KORA_DYNAMIC_DYNAMIC_HPP
 
-#include "kora/dynamic/detail.hpp"
+#include "kora/utility.hpp"
 
 KORA_PUSH_VISIBLE
-#include <boost/variant.hpp>
+#include <boost/blank.hpp>
+#include <boost/variant/static_visitor.hpp>
 KORA_POP_VISIBILITY
 
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
 namespace kora {
 
 class dynamic_t;
+class document_t;
 
 namespace dynamic {
 
@@ -129,6 +135,27 @@ struct converter {
  *
  * The reason why the integer type and unsigned integer type are separated is because the latter
  * can store positive numbers of wider range. This ability may be important in some usecases.
+ *
+ * Scalars and short strings are stored inline, while longer strings, arrays and objects are
+ * allocated on the heap, so the object itself takes 16 bytes on 64-bit platforms.
+ *
+ * Arrays and objects are shared between copies of a value and copied on write: copying takes
+ * constant time, and non-const as_array(), as_object() or apply() copy the container
+ * if it's shared with other values. The reference counter is atomic, and const methods don't modify
+ * the shared items, so copies of the same value may be read and modified in different threads.
+ * Once a mutable reference to a container has been handed out, the container may be modified through it
+ * at any time, so it's no longer shared: copying the value copies the container, like copying
+ * a copy-on-write std::string after taking a reference to its character. The copy is shared as usual.
+ * So a value may be inserted into itself, e.g. <tt>array.as_array().push_back(array)</tt>.
+ *
+ * hash_value() saves the hashes of arrays and objects in them, except for the containers which
+ * mutable references were handed out for, since they may be modified at any time. Comparison of hashed
+ * values returns \p false without visiting the items of containers whose saved hashes differ,
+ * so it's worth hashing a tree which is compared many times, e.g. a parsed tree or a copy of a built one.
+ *
+ * Arrays and objects read by dynamic::read_lazy_json() below the given depth are kept as JSON text
+ * and parsed on the first access. Copies share the parsed value, and the text is written by write_json()
+ * as is until the value is modified.
  */
 class dynamic_t {
 public:
@@ -184,6 +211,9 @@ public:
     // See comments in the definition of the class.
     class object_t;
 
+    //! Strings of at most this length are stored inline without allocating memory.
+    static const size_t short_string_capacity = 14;
+
     // Just useful constants which may be accessed by reference from any place of the program.
     KORA_API static const dynamic_t null;
     KORA_API static const dynamic_t empty_string;
@@ -203,7 +233,10 @@ public:
     KORA_API
     dynamic_t(const dynamic_t& other);
 
-    KORA_API
+    /*! Move constructor. Nothing is allocated or copied.
+     * \warning A value moved out of a document_t still refers to the memory of the document,
+     * unlike a copy of the value.
+     */
     dynamic_t(dynamic_t&& other) KORA_NOEXCEPT;
 
     KORA_API
@@ -227,8 +260,17 @@ public:
     KORA_API
     dynamic_t(const string_t& value);
 
+    /*! Creates dynamic object containing a string value.
+     * \throws std::bad_alloc
+     */
     KORA_API
-    dynamic_t(string_t&& value) KORA_NOEXCEPT;
+    dynamic_t(string_t&& value);
+
+    /*! Creates dynamic object containing a copy of the referenced characters.
+     * \throws std::bad_alloc
+     */
+    KORA_API
+    dynamic_t(const string_view_t& value);
 
     /*! Creates dynamic object containing an array.
      * \throws std::bad_alloc
@@ -263,6 +305,8 @@ public:
     );
 #endif
 
+    ~dynamic_t() KORA_NOEXCEPT;
+
     /*! Copy assignment operator.
      * \throws std::bad_alloc
      */
@@ -270,10 +314,13 @@ public:
     dynamic_t&
     operator=(const dynamic_t& other);
 
-    KORA_API
     dynamic_t&
     operator=(dynamic_t&& other) KORA_NOEXCEPT;
 
+    //! Exchanges the values of the objects. Nothing is allocated or copied.
+    void
+    swap(dynamic_t& other) KORA_NOEXCEPT;
+
     KORA_API
     dynamic_t&
     operator=(null_t value) KORA_NOEXCEPT;
@@ -301,9 +348,19 @@ public:
     dynamic_t&
     operator=(const string_t& value);
 
+    /*! Assigns string value to the object.
+     * \throws std::bad_alloc
+     */
     KORA_API
     dynamic_t&
-    operator=(string_t&& value) KORA_NOEXCEPT;
+    operator=(string_t&& value);
+
+    /*! Assigns a copy of the referenced characters to the object.
+     * \throws std::bad_alloc
+     */
+    KORA_API
+    dynamic_t&
+    operator=(const string_view_t& value);
 
     /*! Assigns array to the object.
      * \throws std::bad_alloc
@@ -391,14 +448,24 @@ public:
     bool
     is_string() const KORA_NOEXCEPT;
 
+    //! JSON text created by from_json_text() is an array if it starts with a bracket, even before it's parsed.
     KORA_API
     bool
     is_array() const KORA_NOEXCEPT;
 
+    //! Like is_array(), it returns \p true for JSON text which starts with a brace without parsing it.
     KORA_API
     bool
     is_object() const KORA_NOEXCEPT;
 
+    /*! \returns JSON text of the array or object read by dynamic::read_lazy_json(), created by from_json_text()
+     * or from dynamic::raw_json_t,
+     * if it hasn't been modified since. Otherwise the view is empty.
+     */
+    KORA_API
+    string_view_t
+    json_text() const KORA_NOEXCEPT;
+
     //! \returns Stored bool value.
     //! \throws expected_bool_t if the object doesn't contain value of type dynamic_t::bool_t.
     KORA_API
@@ -423,12 +490,27 @@ public:
     double_t
     as_double() const;
 
-    //! \returns Stored string.
-    //! \throws expected_string_t if the object doesn't contain value of type dynamic_t::string_t.
+    /*! \returns Copy of the stored string.
+     * \throws expected_string_t if the object doesn't contain value of type dynamic_t::string_t.
+     * \throws std::bad_alloc
+     *
+     * Short strings and strings of a document_t aren't stored as std::string, so there is nothing to refer to,
+     * and a const object isn't modified to create one: copies of a value share their arrays and objects,
+     * so the strings in them may be read from several threads at once.
+     * Use as_string_view() to access the characters without copying them.
+     */
     KORA_API
-    const string_t&
+    string_t
     as_string() const;
 
+    /*! \returns View of the stored string. The characters are followed by the terminating zero.
+     * The view is valid until the object is modified or destroyed.
+     * \throws expected_string_t if the object doesn't contain value of type dynamic_t::string_t.
+     */
+    KORA_API
+    string_view_t
+    as_string_view() const;
+
     //! \returns Stored array.
     //! \throws expected_array_t if the object doesn't contain value of type dynamic_t::array_t.
     KORA_API
@@ -441,24 +523,66 @@ public:
     const object_t&
     as_object() const;
 
-    //! \returns Stored string.
-    //! \throws expected_string_t if the object doesn't contain value of type dynamic_t::string_t.
+    /*! \returns Stored string. A string stored inline or in a document_t is copied to the heap first.
+     * \throws expected_string_t if the object doesn't contain value of type dynamic_t::string_t.
+     * \throws std::bad_alloc
+     */
     KORA_API
     string_t&
     as_string();
 
-    //! \returns Stored array.
-    //! \throws expected_array_t if the object doesn't contain value of type dynamic_t::array_t.
+    /*! \returns Stored array. If the array is shared with copies of the object, it's copied first.
+     * The array isn't shared with the copies made after that, since it may be modified through the reference.
+     * \throws expected_array_t if the object doesn't contain value of type dynamic_t::array_t.
+     * \throws std::bad_alloc
+     */
     KORA_API
     array_t&
     as_array();
 
-    //! \returns Stored object.
-    //! \throws expected_object_t if the object doesn't contain value of type dynamic_t::object_t.
+    /*! \returns Stored object. If the object is shared with copies of this one, it's copied first.
+     * The object isn't shared with the copies made after that, since it may be modified through the reference.
+     * \throws expected_object_t if the object doesn't contain value of type dynamic_t::object_t.
+     * \throws std::bad_alloc
+     */
     KORA_API
     object_t&
     as_object();
 
+    /*! Replaces the stored value with an empty array and returns it to be filled in place.
+     * The array is allocated directly in the object, so no temporary array is created and moved.
+     * Like with as_array(), the array isn't shared with copies of the object.
+     * \param size_hint Number of elements to reserve space for.
+     * \throws std::bad_alloc
+     */
+    KORA_API
+    array_t&
+    emplace_array(size_t size_hint = 0);
+
+    /*! Replaces the stored value with an empty object and returns it to be filled in place.
+     * Like with as_object(), the object isn't shared with copies of this one.
+     * \param size_hint Number of items to reserve space for.
+     * \throws std::bad_alloc
+     */
+    KORA_API
+    object_t&
+    emplace_object(size_t size_hint = 0);
+
+    /*! Creates array or object which is parsed from JSON text on the first access.
+     *
+     * The text is checked here by rapidjson without creating any values, so the later parsing doesn't fail
+     * on the syntax.
+     *
+     * \param buffer Memory holding the text. It's retained by the value and its copies.
+     * \param text JSON array or object. The surrounding whitespace is dropped.
+     * \throws json_parsing_error_t If the text isn't a single array or object.
+     * \throws std::bad_alloc
+     */
+    KORA_API
+    static
+    dynamic_t
+    from_json_text(std::shared_ptr<const std::string> buffer, const string_view_t& text);
+
     /*! Checks whether the conversion of the object to a type is possible.
      *
      * It uses dynamic::converter::convertible() to perform the check.\n
@@ -510,49 +634,206 @@ public:
     to() const;
 
 private:
+    enum type_t: unsigned char {
+        null_type,
+        bool_type,
+        int_type,
+        uint_type,
+        double_type,
+        short_string_type,
+        string_type,
+        arena_string_type,
+        array_type,
+        object_type,
+        json_text_type
+    };
+
+    // Immutable string placed in the arena of a document_t.
+    struct arena_string_t {
+        size_t size;
+        char data[1];
+    };
+
+    // Container shared by copies of a value.
     template<class T>
+    struct shared_t {
+        template<class... Args>
+        explicit
+        shared_t(Args&&... args) :
+            references(1),
+            hash(0),
+            unshareable(false),
+            value(std::forward<Args>(args)...)
+        { }
+
+        std::atomic<size_t> references;
+
+        // Hash of the contents saved by hash_value(), or zero if it's unknown.
+        std::atomic<uint64_t> hash;
+
+        // Set once a mutable reference to the value is handed out. The value may be modified through
+        // the reference at any time, so copies of the owner get their own copy of the container.
+        bool unshareable;
+
+        T value;
+    };
+
+    // Array or object kept as JSON text, which is parsed on the first access.
+    struct json_text_t {
+        json_text_t(std::shared_ptr<const std::string> buffer, const string_view_t& text) :
+            buffer(std::move(buffer)),
+            text(text),
+            parsed(nullptr)
+        { }
+
+        ~json_text_t() {
+            delete parsed.load(std::memory_order_acquire);
+        }
+
+        std::shared_ptr<const std::string> buffer;
+        string_view_t text;
+
+        // The value parsed from the text, or null until the first access.
+        std::atomic<dynamic_t*> parsed;
+    };
+
+    union value_t {
+        bool_t bool_value;
+        int_t int_value;
+        uint_t uint_value;
+        double_t double_value;
+        string_t *string_value;
+        arena_string_t *arena_string_value;
+        shared_t<array_t> *array_value;
+        shared_t<object_t> *object_value;
+        shared_t<json_text_t> *json_text_value;
+    };
+
+    // Both layouts keep the type in the last byte.
+    // An inline string is followed by its unused capacity, which is zero when the buffer is full,
+    // so the characters are always zero-terminated.
+    // Arrays and objects with \p in_arena flag are placed in the arena of a document_t. They are never
+    // shared, so copies of them are deep, and only their destructors are called.
+    union storage_t {
+        struct {
+            value_t value;
+            bool in_arena;
+            char reserved[short_string_capacity - sizeof(value_t)];
+            type_t type;
+        } common;
+
+        struct {
+            char data[short_string_capacity];
+            unsigned char unused;
+            type_t type;
+        } short_string;
+    };
+
+    static
+    storage_t
+    make_string(const char *data, size_t size);
+
+    static
+    storage_t
+    make_string(string_t&& value);
+
+    // Returns false for arrays and objects placed in a document or marked as unshareable.
+    static
     bool
-    is() const;
+    shareable(const dynamic_t& value) KORA_NOEXCEPT;
+
+    // Makes a deep copy of the array or object which can't be shared.
+    // Subtrees which can be shared are shared.
+    void
+    copy_unshareable(const dynamic_t& other);
 
-    struct move_visitor;
+    // Creates JSON text without checking it. The readers use it for the text they have already parsed.
+    static
+    dynamic_t
+    make_json_text(std::shared_ptr<const std::string> buffer, const string_view_t& text);
+
+    // Returns the value parsed from the text of json_text_type. The text is parsed by the first call.
+    const dynamic_t&
+    parse_json_text() const;
+
+    // Replaces the stored value with a new one. The old value is destroyed after the replacement,
+    // so the new value may be taken from a subobject of the old one.
+    void
+    reset(const storage_t& storage) KORA_NOEXCEPT;
+
+    // Frees the memory owned by the value.
+    KORA_API
+    static
+    void
+    destroy(const storage_t& storage) KORA_NOEXCEPT;
+
+    // Steps of the traversals of trees without recursion done by destroy(), operator== and hash_value().
+    // They are defined in dynamic.cpp.
+    class shallow_destroyer_t;
+    class shallow_comparator_t;
+    class shallow_hasher_t;
 
 private:
-    typedef boost::variant<
-        null_t,
-        bool_t,
-        int_t,
-        uint_t,
-        double_t,
-        string_t,
-        detail::dynamic::incomplete_wrapper<array_t>,
-        detail::dynamic::incomplete_wrapper<object_t>
-    > value_t;
-
-    value_t m_value;
+    friend class document_t;
+    friend struct json_reader_access_t;
+
+    friend bool operator==(const dynamic_t& left, const dynamic_t& right);
+    friend size_t hash_value(const dynamic_t& value);
+
+    storage_t m_storage;
 };
 
 /*!
  * \relates dynamic_t
  * \returns \p true if \p left and \p right store equal values of the same type,
  * or if they store equal numeric values (<tt>5.0 == 5</tt>). Otherwise it returns \p false.
+ *
+ * Nested containers are compared without recursion, keeping the pairs of containers being compared
+ * on a stack allocated on the heap, so the comparison may throw.
+ *
+ * \throws std::bad_alloc
  */
 KORA_API
 bool
-operator==(const dynamic_t& left, const dynamic_t& right) KORA_NOEXCEPT;
+operator==(const dynamic_t& left, const dynamic_t& right);
 
 /*!
  * \relates dynamic_t
  * \sa operator==(const dynamic_t&, const dynamic_t&)
  * \returns Opposite to the operator==(const dynamic_t&, const dynamic_t&).
+ * \throws std::bad_alloc
  */
 KORA_API
 bool
-operator!=(const dynamic_t& left, const dynamic_t& right) KORA_NOEXCEPT;
+operator!=(const dynamic_t& left, const dynamic_t& right);
+
+/*!
+ * \relates dynamic_t
+ * Exchanges the values of the objects. Found by argument-dependent lookup, so std::swap() isn't used.
+ */
+void
+swap(dynamic_t& left, dynamic_t& right) KORA_NOEXCEPT;
+
+/*!
+ * \relates dynamic_t
+ * \returns Hash of the value, which is equal for the objects equal by operator==(const dynamic_t&, const dynamic_t&).
+ *
+ * Numbers are hashed as doubles, so integers beyond 2^53 which round to the same double have the same hash.
+ * Items of objects are hashed regardless of their order.
+ * Nested containers are hashed without recursion, keeping the containers being hashed on a stack allocated
+ * on the heap, and JSON text is parsed to be hashed, so it isn't noexcept.
+ *
+ * \throws std::bad_alloc
+ */
+KORA_API
+size_t
+hash_value(const dynamic_t& value);
 
 /*!
  * \relates dynamic_t
  * Prints the value stored in the dynamic object. Null value is printed as "null",
  * boolean as value of type \p bool, array and object are printed in JSON format.
+ * Finite doubles are printed like in JSON, so they are read back exactly.
  *
  * \param stream Stream to print to.
  * \param value Object to print.
@@ -564,6 +845,22 @@ operator<<(std::ostream& stream, const dynamic_t& value);
 
 } // namespace kora
 
+namespace std {
+
+//! Allows to use dynamic_t as a key of unordered containers. It may throw std::bad_alloc like hash_value().
+template<>
+struct hash<kora::dynamic_t> {
+    typedef kora::dynamic_t argument_type;
+    typedef size_t result_type;
+
+    size_t
+    operator()(const kora::dynamic_t& value) const {
+        return kora::hash_value(value);
+    }
+};
+
+} // namespace std
+
 #include "kora/dynamic/dynamic.inl"
 #include "kora/dynamic/object.hpp"
 
@@ -54,12 +54,64 @@ struct default_conversion_controller_t {
 
 }} // namespace detail::dynamic
 
+// Moving and destruction are used a lot by containers, so they are inlined,
+// and only values owning memory call out to the library.
+
+inline
+dynamic_t::dynamic_t(dynamic_t&& other) KORA_NOEXCEPT :
+    m_storage(other.m_storage)
+{
+    other.m_storage.common.type = null_type;
+}
+
+inline
+dynamic_t::~dynamic_t() KORA_NOEXCEPT {
+    if (m_storage.common.type >= string_type) {
+        destroy(m_storage);
+    }
+}
+
+inline
+dynamic_t&
+dynamic_t::operator=(dynamic_t&& other) KORA_NOEXCEPT {
+    if (this != &other) {
+        const storage_t storage = other.m_storage;
+        other.m_storage.common.type = null_type;
+        reset(storage);
+    }
+
+    return *this;
+}
+
+inline
+void
+dynamic_t::swap(dynamic_t& other) KORA_NOEXCEPT {
+    std::swap(m_storage, other.m_storage);
+}
+
+inline
+void
+swap(dynamic_t& left, dynamic_t& right) KORA_NOEXCEPT {
+    left.swap(right);
+}
+
+inline
+void
+dynamic_t::reset(const storage_t& storage) KORA_NOEXCEPT {
+    const storage_t old_storage = m_storage;
+    m_storage = storage;
+
+    if (old_storage.common.type >= string_type) {
+        destroy(old_storage);
+    }
+}
+
 template<class T>
 dynamic_t::dynamic_t(
     T&& from,
     typename std::enable_if<dynamic::constructor<typename pristine<T>::type>::enable>::type*
 ) :
-    m_value(null_t())
+    m_storage()
 {
     dynamic::constructor<typename pristine<T>::type>::convert(std::forward<T>(from), *this);
 }
@@ -92,21 +144,72 @@ dynamic_t::to() const {
 template<class Visitor>
 typename std::decay<Visitor>::type::result_type
 dynamic_t::apply(Visitor&& visitor) {
-    typedef detail::dynamic::dynamic_visitor_applier<Visitor> applier_type;
-    return boost::apply_visitor(applier_type(&visitor), m_value);
+    switch (m_storage.common.type) {
+    case bool_type:
+        return std::forward<Visitor>(visitor)(m_storage.common.value.bool_value);
+    case int_type:
+        return std::forward<Visitor>(visitor)(m_storage.common.value.int_value);
+    case uint_type:
+        return std::forward<Visitor>(visitor)(m_storage.common.value.uint_value);
+    case double_type:
+        return std::forward<Visitor>(visitor)(m_storage.common.value.double_value);
+    case short_string_type:
+    case string_type:
+    case arena_string_type:
+        return std::forward<Visitor>(visitor)(as_string());
+    case array_type:
+        return std::forward<Visitor>(visitor)(as_array());
+    case object_type:
+        return std::forward<Visitor>(visitor)(as_object());
+    case json_text_type:
+        if (is_array()) {
+            return std::forward<Visitor>(visitor)(as_array());
+        } else {
+            return std::forward<Visitor>(visitor)(as_object());
+        }
+    case null_type:
+    default: {
+        null_t null_value;
+        return std::forward<Visitor>(visitor)(null_value);
+    }
+    }
 }
 
 template<class Visitor>
 typename std::decay<Visitor>::type::result_type
 dynamic_t::apply(Visitor&& visitor) const {
-    typedef detail::dynamic::dynamic_visitor_applier<Visitor> applier_type;
-    return boost::apply_visitor(applier_type(&visitor), m_value);
-}
-
-template<class T>
-bool
-dynamic_t::is() const {
-    return static_cast<bool>(boost::get<T>(&m_value));
+    switch (m_storage.common.type) {
+    case bool_type:
+        return std::forward<Visitor>(visitor)(static_cast<const bool_t&>(m_storage.common.value.bool_value));
+    case int_type:
+        return std::forward<Visitor>(visitor)(static_cast<const int_t&>(m_storage.common.value.int_value));
+    case uint_type:
+        return std::forward<Visitor>(visitor)(static_cast<const uint_t&>(m_storage.common.value.uint_value));
+    case double_type:
+        return std::forward<Visitor>(visitor)(static_cast<const double_t&>(m_storage.common.value.double_value));
+    case short_string_type:
+    case arena_string_type: {
+        const string_t value(as_string());
+        return std::forward<Visitor>(visitor)(value);
+    }
+    case string_type:
+        return std::forward<Visitor>(visitor)(static_cast<const string_t&>(*m_storage.common.value.string_value));
+    case array_type:
+        return std::forward<Visitor>(visitor)(as_array());
+    case object_type:
+        return std::forward<Visitor>(visitor)(as_object());
+    case json_text_type:
+        if (is_array()) {
+            return std::forward<Visitor>(visitor)(as_array());
+        } else {
+            return std::forward<Visitor>(visitor)(as_object());
+        }
+    case null_type:
+    default: {
+        const null_t null_value = null_t();
+        return std::forward<Visitor>(visitor)(null_value);
+    }
+    }
 }
 
 } // namespace kora
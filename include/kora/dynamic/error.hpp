@@ -56,6 +56,28 @@ private:
     std::string m_message;
 };
 
+//! Thrown when a path given to json_projection_t is incorrect.
+class KORA_API json_path_error_t :
+    public std::invalid_argument
+{
+public:
+    /*!
+     * \param[in] path The incorrect path.
+     * \param[in] offset Position of the error in the path.
+     * \throws std::bad_alloc
+     */
+    json_path_error_t(const std::string& path, size_t offset);
+
+    ~json_path_error_t() KORA_NOEXCEPT;
+
+    //! \returns Position of the error in the path.
+    size_t
+    offset() const KORA_NOEXCEPT;
+
+private:
+    size_t m_offset;
+};
+
 //! Base type for all errors generated by dynamic::converter.
 class KORA_API bad_cast_t :
     public std::bad_cast
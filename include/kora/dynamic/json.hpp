@@ -21,10 +21,14 @@
 #ifndef KORA_DYNAMIC_JSON_HPP
 #define KORA_DYNAMIC_JSON_HPP
 
+#include "kora/dynamic/document.hpp"
 #include "kora/dynamic/dynamic.hpp"
 
 #include <istream>
+#include <memory>
 #include <ostream>
+#include <string>
+#include <vector>
 
 namespace kora {
 
@@ -36,6 +40,9 @@ namespace kora {
  * It's not like standard JSON, and you should perform additional checks on yourown
  * if you want to receive a JSON object or array.
  *
+ * Finite doubles are written with the fewest digits which are read back as the same double
+ * (a few more in rare cases), and integral ones get ".0" to be read back as doubles.
+ *
  * \param output Stream to write the resulting JSON to.
  * \param value The dynamic object to serialize.
  * \throws std::bad_alloc
@@ -95,6 +102,74 @@ KORA_API
 std::string
 to_pretty_json(const dynamic_t& value, size_t indent = 4);
 
+/*! Receiver of the events produced by a JSON reader.
+ *
+ * It allows to process JSON without building a dynamic_t tree, so streams of any size may be read
+ * in constant memory. The reader calls the methods in the order of the values in the input:
+ * arrays and objects are surrounded by start and finish events, and each value of an object
+ * is preceded by key(). The methods do nothing by default, so a handler overrides only the events
+ * it needs.
+ *
+ * The views passed to string() and key() are valid only during the call.
+ * An exception thrown by a method stops the reading and is propagated to the caller.
+ */
+class KORA_API json_handler_t {
+public:
+    virtual
+    ~json_handler_t() KORA_NOEXCEPT;
+
+    virtual
+    void
+    null();
+
+    virtual
+    void
+    boolean(dynamic_t::bool_t value);
+
+    //! Negative integers.
+    virtual
+    void
+    integer(dynamic_t::int_t value);
+
+    //! Non-negative integers.
+    virtual
+    void
+    unsigned_integer(dynamic_t::uint_t value);
+
+    //! Numbers with a fraction or an exponent, and integers out of the range of the integer types.
+    virtual
+    void
+    floating_point(dynamic_t::double_t value);
+
+    virtual
+    void
+    string(const string_view_t& value);
+
+    virtual
+    void
+    key(const string_view_t& value);
+
+    virtual
+    void
+    start_array();
+
+    //! \param size Number of the values in the array.
+    virtual
+    void
+    finish_array(size_t size);
+
+    virtual
+    void
+    start_object();
+
+    //! \param size Number of the items in the object.
+    virtual
+    void
+    finish_object(size_t size);
+};
+
+class json_projection_t;
+
 namespace dynamic {
 
 /*!\relatesalso kora::dynamic_t
@@ -114,8 +189,261 @@ KORA_API
 dynamic_t
 read_json(std::istream &input);
 
+/*!\relatesalso kora::dynamic_t
+ *
+ * Creates dynamic object from JSON stored in memory.
+ *
+ * It works exactly as read_json(std::istream&), but parses the data in place without copying it.
+ * Like the stream version, it reads one JSON object with surrounding spaces and ignores the rest of the buffer.
+ *
+ * \param data Pointer to the JSON.
+ * \param size Size of the buffer.
+ * \param[out] consumed If not null, receives the number of characters read from the buffer
+ * (including the surrounding spaces).
+ * \returns Constructed dynamic object.
+ * \throws json_parsing_error_t The offset of the error is counted from \p data.
+ * \throws std::bad_alloc
+ *
+ * \sa read_json(std::istream&)
+ */
+KORA_API
+dynamic_t
+read_json(const char *data, size_t size, size_t *consumed = nullptr);
+
+/*!\relatesalso kora::dynamic_t
+ *
+ * Creates dynamic object from JSON stored in a string.
+ *
+ * \sa read_json(const char*, size_t, size_t*)
+ */
+KORA_API
+dynamic_t
+read_json(const std::string &input, size_t *consumed = nullptr);
+
+/*!\relatesalso kora::dynamic_t
+ *
+ * Reads JSON into the root of the document.
+ *
+ * It works exactly as read_json(std::istream&), but long strings, arrays and objects are allocated
+ * in the document. The previous root is destroyed, but its memory is kept until document_t::clear().
+ * If the document interns strings, repeated long string values are stored once.
+ *
+ * \returns The root of the document.
+ *
+ * \sa document_t
+ */
+KORA_API
+dynamic_t&
+read_json(std::istream &input, document_t &document);
+
+/*!\relatesalso kora::dynamic_t
+ *
+ * Reads JSON stored in memory into the root of the document.
+ *
+ * \returns The root of the document.
+ *
+ * \sa read_json(std::istream&, document_t&)
+ * \sa read_json(const char*, size_t, size_t*)
+ */
+KORA_API
+dynamic_t&
+read_json(const char *data, size_t size, document_t &document, size_t *consumed = nullptr);
+
+/*! Reads JSON and passes its values to the handler instead of building dynamic_t.
+ *
+ * Like read_json(std::istream&), it reads one JSON object with surrounding spaces.
+ * If the handler throws, the characters after the last reported value may be left unread.
+ *
+ * \throws json_parsing_error_t The handler receives the events preceding the error.
+ * \throws std::bad_alloc
+ * \throws Any exception thrown by \p input or \p handler.
+ *
+ * \sa json_handler_t
+ */
+KORA_API
+void
+read_json(std::istream &input, json_handler_t &handler);
+
+/*! Reads JSON stored in memory and passes its values to the handler.
+ *
+ * \sa read_json(std::istream&, json_handler_t&)
+ * \sa read_json(const char*, size_t, size_t*)
+ */
+KORA_API
+void
+read_json(const char *data, size_t size, json_handler_t &handler, size_t *consumed = nullptr);
+
+/*!\relatesalso kora::dynamic_t
+ *
+ * Reads only the parts of JSON selected by the projection.
+ *
+ * The values which aren't selected are skipped without creating strings or dynamic objects.
+ * The selected values keep their places in the tree: they are stored in the objects and arrays
+ * on the path from the root, which contain only the items leading to selected values.
+ * Skipped items of arrays which precede selected ones are replaced with nulls to keep the indexes.
+ *
+ * \returns Selected part of the JSON, or null if nothing is selected.
+ * \throws json_parsing_error_t
+ * \throws std::bad_alloc
+ * \throws Any exception thrown by \p input.
+ *
+ * \sa json_projection_t
+ */
+KORA_API
+dynamic_t
+read_json(std::istream &input, const json_projection_t &projection);
+
+/*!\relatesalso kora::dynamic_t
+ *
+ * Reads only the parts of JSON stored in memory selected by the projection.
+ *
+ * \sa read_json(std::istream&, const json_projection_t&)
+ * \sa read_json(const char*, size_t, size_t*)
+ */
+KORA_API
+dynamic_t
+read_json(const char *data, size_t size, const json_projection_t &projection, size_t *consumed = nullptr);
+
+/*!\relatesalso kora::dynamic_t
+ *
+ * Reads JSON building only the top levels of the tree.
+ *
+ * Arrays and objects nested deeper than \p depth are checked but not built. They are kept as slices
+ * of the input, which are parsed on the first access through as_array(), as_object(), apply() or to().
+ * write_json() writes an unmodified slice as is. It's useful when only a few parts of a large JSON are read,
+ * and the rest is passed through.
+ *
+ * The input is moved to memory shared by the slices, and it's retained while any of them exists.
+ *
+ * \param input The JSON.
+ * \param depth Number of the levels to build. The root is the first level, so zero keeps the whole JSON as text.
+ * \param[out] consumed If not null, receives the number of characters read from the input.
+ * \returns Constructed dynamic object.
+ * \throws json_parsing_error_t
+ * \throws std::bad_alloc
+ *
+ * \sa dynamic_t::json_text()
+ */
+KORA_API
+dynamic_t
+read_lazy_json(std::string input, size_t depth, size_t *consumed = nullptr);
+
+/*!\relatesalso kora::dynamic_t
+ *
+ * Reads JSON stored in memory building only the top levels of the tree. The input is copied.
+ *
+ * \sa read_lazy_json(std::string, size_t, size_t*)
+ */
+KORA_API
+dynamic_t
+read_lazy_json(const char *data, size_t size, size_t depth, size_t *consumed = nullptr);
+
 } // namespace dynamic
 
+/*! Compiled set of paths selecting the parts of JSON to read.
+ *
+ * A path consists of optional \p $ denoting the root and steps:
+ *  - <tt>.key</tt> selects the value of the key in an object. The dot may be omitted in the first step
+ *    if the path doesn't start with \p $. The key is terminated by the next dot or bracket.
+ *  - <tt>.*</tt> selects all the values of an object.
+ *  - <tt>[n]</tt> selects the n-th value of an array.
+ *  - <tt>[*]</tt> selects all the values of an array.
+ *
+ * For example, \p $.meta.id and \p items[*].price. An empty path or \p $ selects the whole JSON.
+ * The projection is immutable, so it may be used by several threads at once.
+ *
+ * \sa dynamic::read_json(std::istream&, const json_projection_t&)
+ */
+class json_projection_t {
+    KORA_NONCOPYABLE(json_projection_t)
+
+public:
+    /*!
+     * \throws json_path_error_t If a path is incorrect.
+     * \throws std::bad_alloc
+     */
+    KORA_API
+    explicit
+    json_projection_t(const std::vector<std::string>& paths);
+
+    KORA_API
+    ~json_projection_t() KORA_NOEXCEPT;
+
+private:
+    class implementation_t;
+
+    std::unique_ptr<implementation_t> m_impl;
+
+    friend class json_parser_t;
+
+    friend
+    dynamic_t
+    dynamic::read_json(std::istream &input, const json_projection_t &projection);
+
+    friend
+    dynamic_t
+    dynamic::read_json(const char *data, size_t size, const json_projection_t &projection, size_t *consumed);
+};
+
+/*! Reusable JSON parser.
+ *
+ * It works exactly as dynamic::read_json(), but keeps the memory used during parsing between calls,
+ * so parsing of many small documents doesn't allocate anything except the resulting dynamic objects.
+ *
+ * \warning The parser isn't thread-safe. Use one object per thread.
+ */
+class json_parser_t {
+    KORA_NONCOPYABLE(json_parser_t)
+
+public:
+    //! \throws std::bad_alloc
+    KORA_API
+    json_parser_t();
+
+    KORA_API
+    ~json_parser_t() KORA_NOEXCEPT;
+
+    //! \sa dynamic::read_json(std::istream&)
+    KORA_API
+    dynamic_t
+    parse(std::istream &input);
+
+    //! \sa dynamic::read_json(const char*, size_t, size_t*)
+    KORA_API
+    dynamic_t
+    parse(const char *data, size_t size, size_t *consumed = nullptr);
+
+    //! \sa dynamic::read_json(const std::string&, size_t*)
+    KORA_API
+    dynamic_t
+    parse(const std::string &input, size_t *consumed = nullptr);
+
+    //! \sa dynamic::read_json(std::istream&, json_handler_t&)
+    KORA_API
+    void
+    parse(std::istream &input, json_handler_t &handler);
+
+    //! \sa dynamic::read_json(const char*, size_t, json_handler_t&, size_t*)
+    KORA_API
+    void
+    parse(const char *data, size_t size, json_handler_t &handler, size_t *consumed = nullptr);
+
+    //! \sa dynamic::read_json(std::istream&, const json_projection_t&)
+    KORA_API
+    dynamic_t
+    parse(std::istream &input, const json_projection_t &projection);
+
+    //! \sa dynamic::read_json(const char*, size_t, const json_projection_t&, size_t*)
+    KORA_API
+    dynamic_t
+    parse(const char *data, size_t size, const json_projection_t &projection, size_t *consumed = nullptr);
+
+private:
+    class implementation_t;
+
+    std::unique_ptr<implementation_t> m_impl;
+};
+
 } // namespace kora
 
 #endif
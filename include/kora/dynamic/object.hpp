@@ -21,62 +21,426 @@
 #ifndef KORA_DYNAMIC_OBJECT_HPP
 #define KORA_DYNAMIC_OBJECT_HPP
 
+#include <initializer_list>
+#include <iterator>
 #include <map>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace kora {
 
 /*! Type to store unordered associative arrays in dynamic_t (object in terms of JSON).
  *
  * Keys are strings, values are dynamic_t objects.
- * It's like std::map, but may be replaced with unordered_map later, so you only guarenteed to have
- * intersection of their APIs :) Therefore keys order is unspecified, iterators may invalidate, etc.
+ * It provides the intersection of std::map and std::unordered_map APIs, so keys order is unspecified,
+ * iterators may invalidate, etc.
+ *
+ * The items are stored in a vector. Typical objects have a few keys, and for them
+ * the contiguous storage is faster to build, look up and iterate than a tree with a node per key.
+ * Small objects keep the items sorted by key and use binary search.
+ * Once an object reaches hash_threshold items, it builds an open-addressing hash table of
+ * the items positions along with the hashes of their keys, and new items are appended to the vector.
+ * So the items of large objects are iterated, and written to JSON, in the order of insertion after
+ * the sorted ones. Erasing from them moves the last items to the place of the erased ones.
+ * Insertion may invalidate iterators. Erasure invalidates the iterators to the erased and the moved items,
+ * the returned iterator points to the item which took the place of the first erased one.
+ * The keys can't be modified through iterators. Like in std::flat_map, dereferencing an iterator returns
+ * a pair of references to the key and the value instead of a reference to value_type,
+ * so items are bound with <tt>const auto&</tt> or <tt>auto&&</tt>, and <tt>it->second</tt> works as usual.
  */
-class dynamic_t::object_t :
-    public std::map<std::string, dynamic_t>
-{
-    typedef std::map<std::string, dynamic_t> base_type;
+class dynamic_t::object_t {
+    // The items are stored with non-constant keys to be moved around in the vector.
+    typedef std::pair<std::string, dynamic_t> item_type;
+    typedef std::vector<item_type> items_type;
+
+    // Holds the pair of references returned by operator-> of the iterators.
+    template<class Reference>
+    class arrow_proxy {
+    public:
+        explicit
+        arrow_proxy(const Reference& reference) :
+            m_reference(reference)
+        { }
+
+        const Reference*
+        operator->() const {
+            return &m_reference;
+        }
+
+    private:
+        Reference m_reference;
+    };
+
+    // Random access iterator over the stored items, which exposes them as pairs of references
+    // to the constant key and the value.
+    template<class Mapped, class Base>
+    class basic_iterator {
+    public:
+        typedef std::random_access_iterator_tag iterator_category;
+        typedef std::pair<const std::string, dynamic_t> value_type;
+        typedef typename std::iterator_traits<Base>::difference_type difference_type;
+        typedef std::pair<const std::string&, Mapped&> reference;
+        typedef arrow_proxy<reference> pointer;
+
+        basic_iterator() :
+            m_base()
+        { }
+
+        explicit
+        basic_iterator(Base base) :
+            m_base(base)
+        { }
+
+        // Converts iterator to const_iterator.
+        template<class OtherMapped, class OtherBase>
+        basic_iterator(
+            const basic_iterator<OtherMapped, OtherBase>& other,
+            typename std::enable_if<std::is_convertible<OtherBase, Base>::value>::type* = 0
+        ) :
+            m_base(other.base())
+        { }
+
+        Base
+        base() const {
+            return m_base;
+        }
+
+        reference
+        operator*() const {
+            return reference(m_base->first, m_base->second);
+        }
+
+        pointer
+        operator->() const {
+            return pointer(**this);
+        }
+
+        reference
+        operator[](difference_type offset) const {
+            return *(*this + offset);
+        }
+
+        basic_iterator&
+        operator++() {
+            ++m_base;
+            return *this;
+        }
+
+        basic_iterator
+        operator++(int) {
+            return basic_iterator(m_base++);
+        }
+
+        basic_iterator&
+        operator--() {
+            --m_base;
+            return *this;
+        }
+
+        basic_iterator
+        operator--(int) {
+            return basic_iterator(m_base--);
+        }
+
+        basic_iterator&
+        operator+=(difference_type offset) {
+            m_base += offset;
+            return *this;
+        }
+
+        basic_iterator&
+        operator-=(difference_type offset) {
+            m_base -= offset;
+            return *this;
+        }
+
+        basic_iterator
+        operator+(difference_type offset) const {
+            return basic_iterator(m_base + offset);
+        }
+
+        basic_iterator
+        operator-(difference_type offset) const {
+            return basic_iterator(m_base - offset);
+        }
+
+        template<class OtherMapped, class OtherBase>
+        difference_type
+        operator-(const basic_iterator<OtherMapped, OtherBase>& other) const {
+            return m_base - other.base();
+        }
+
+        template<class OtherMapped, class OtherBase>
+        bool
+        operator==(const basic_iterator<OtherMapped, OtherBase>& other) const {
+            return m_base == other.base();
+        }
+
+        template<class OtherMapped, class OtherBase>
+        bool
+        operator!=(const basic_iterator<OtherMapped, OtherBase>& other) const {
+            return m_base != other.base();
+        }
+
+        template<class OtherMapped, class OtherBase>
+        bool
+        operator<(const basic_iterator<OtherMapped, OtherBase>& other) const {
+            return m_base < other.base();
+        }
+
+        template<class OtherMapped, class OtherBase>
+        bool
+        operator>(const basic_iterator<OtherMapped, OtherBase>& other) const {
+            return m_base > other.base();
+        }
+
+        template<class OtherMapped, class OtherBase>
+        bool
+        operator<=(const basic_iterator<OtherMapped, OtherBase>& other) const {
+            return m_base <= other.base();
+        }
+
+        template<class OtherMapped, class OtherBase>
+        bool
+        operator>=(const basic_iterator<OtherMapped, OtherBase>& other) const {
+            return m_base >= other.base();
+        }
+
+    private:
+        Base m_base;
+    };
 
 public:
+    typedef std::string key_type;
+    typedef dynamic_t mapped_type;
+    typedef std::pair<const std::string, dynamic_t> value_type;
+
+    typedef items_type::size_type size_type;
+    typedef items_type::difference_type difference_type;
+    typedef std::pair<const std::string&, dynamic_t&> reference;
+    typedef std::pair<const std::string&, const dynamic_t&> const_reference;
+    typedef basic_iterator<dynamic_t, items_type::iterator> iterator;
+    typedef basic_iterator<const dynamic_t, items_type::const_iterator> const_iterator;
+
+    //! Number of items starting from which the object looks keys up by hash.
+    static const size_type hash_threshold = 32;
+
     object_t() = default;
 
+    //! If a key is repeated, the first value wins.
     template<class InputIt>
     object_t(InputIt first, InputIt last) :
-        base_type(first, last)
-    { }
+        m_items(first, last)
+    {
+        normalize();
+    }
 
     object_t(const object_t& other) :
-        base_type(other)
+        m_items(other.m_items),
+        m_hashes(other.m_hashes),
+        m_index(other.m_index)
     { }
 
     object_t(object_t&& other) KORA_NOEXCEPT :
-        base_type(std::move(other))
+        m_items(std::move(other.m_items)),
+        m_hashes(std::move(other.m_hashes)),
+        m_index(std::move(other.m_index))
     { }
 
     object_t(std::initializer_list<value_type> list) :
-        base_type(list)
-    { }
+        m_items(list.begin(), list.end())
+    {
+        normalize();
+    }
 
-    object_t(const base_type& other) :
-        base_type(other)
-    { }
+    KORA_API
+    object_t(const std::map<std::string, dynamic_t>& other);
 
-    object_t(base_type&& other) KORA_NOEXCEPT :
-        base_type(std::move(other))
-    { }
+    KORA_API
+    object_t(std::map<std::string, dynamic_t>&& other);
 
     object_t&
     operator=(const object_t& other) {
-        base_type::operator=(other);
+        m_items = other.m_items;
+        m_hashes = other.m_hashes;
+        m_index = other.m_index;
         return *this;
     }
 
     object_t&
     operator=(object_t&& other) KORA_NOEXCEPT {
-        base_type::operator=(std::move(other));
+        m_items = std::move(other.m_items);
+        m_hashes = std::move(other.m_hashes);
+        m_index = std::move(other.m_index);
         return *this;
     }
 
-    using base_type::at;
+    iterator
+    begin() KORA_NOEXCEPT {
+        return iterator(m_items.begin());
+    }
+
+    const_iterator
+    begin() const KORA_NOEXCEPT {
+        return const_iterator(m_items.begin());
+    }
+
+    const_iterator
+    cbegin() const KORA_NOEXCEPT {
+        return const_iterator(m_items.begin());
+    }
+
+    iterator
+    end() KORA_NOEXCEPT {
+        return iterator(m_items.end());
+    }
+
+    const_iterator
+    end() const KORA_NOEXCEPT {
+        return const_iterator(m_items.end());
+    }
+
+    const_iterator
+    cend() const KORA_NOEXCEPT {
+        return const_iterator(m_items.end());
+    }
+
+    bool
+    empty() const KORA_NOEXCEPT {
+        return m_items.empty();
+    }
+
+    size_type
+    size() const KORA_NOEXCEPT {
+        return m_items.size();
+    }
+
+    size_type
+    max_size() const KORA_NOEXCEPT {
+        return m_items.max_size();
+    }
+
+    //! Preallocates memory for \p size items.
+    void
+    reserve(size_type size) {
+        m_items.reserve(size);
+    }
+
+    void
+    clear() KORA_NOEXCEPT {
+        m_items.clear();
+        m_hashes.clear();
+        m_index.clear();
+    }
+
+    void
+    swap(object_t& other) KORA_NOEXCEPT {
+        m_items.swap(other.m_items);
+        m_hashes.swap(other.m_hashes);
+        m_index.swap(other.m_index);
+    }
+
+    KORA_API
+    iterator
+    find(const std::string& key);
+
+    KORA_API
+    const_iterator
+    find(const std::string& key) const;
+
+    KORA_API
+    size_type
+    count(const std::string& key) const;
+
+    /*! Inserts the item if the object doesn't contain its key.
+     * \returns Iterator to the item with the key and \p true if the item was inserted.
+     */
+    KORA_API
+    std::pair<iterator, bool>
+    insert(const value_type& value);
+
+    KORA_API
+    std::pair<iterator, bool>
+    insert(value_type&& value);
+
+    //! Inserts the item constructed from \p value, e.g. std::pair<std::string, dynamic_t> with the key to move.
+    template<class P>
+    typename std::enable_if<std::is_convertible<P&&, item_type>::value, std::pair<iterator, bool>>::type
+    insert(P&& value) {
+        return insert_item(item_type(std::forward<P>(value)));
+    }
+
+    /*! Inserts the item if the object doesn't contain its key.
+     * Inserting keys in ascending order with \p hint equal to end() takes constant time.
+     * \returns Iterator to the item with the key.
+     */
+    KORA_API
+    iterator
+    insert(const_iterator hint, const value_type& value);
+
+    KORA_API
+    iterator
+    insert(const_iterator hint, value_type&& value);
+
+    template<class P>
+    typename std::enable_if<std::is_convertible<P&&, item_type>::value, iterator>::type
+    insert(const_iterator, P&& value) {
+        // Appending is already the fast path of the regular insert.
+        return insert_item(item_type(std::forward<P>(value))).first;
+    }
+
+    template<class InputIt>
+    void
+    insert(InputIt first, InputIt last) {
+        for (; first != last; ++first) {
+            insert(end(), *first);
+        }
+    }
+
+    void
+    insert(std::initializer_list<value_type> list) {
+        insert(list.begin(), list.end());
+    }
+
+    template<class... Args>
+    std::pair<iterator, bool>
+    emplace(Args&&... args) {
+        return insert_item(item_type(std::forward<Args>(args)...));
+    }
+
+    KORA_API
+    iterator
+    erase(const_iterator position);
+
+    KORA_API
+    iterator
+    erase(const_iterator first, const_iterator last);
+
+    KORA_API
+    size_type
+    erase(const std::string& key);
+
+    /*! Get value by key.
+     *
+     * \param[in] key The key to search in the object.
+     * \returns Value stored by the key.
+     * \throws std::out_of_range When the object doesn't contain the key.
+     */
+    KORA_API
+    dynamic_t&
+    at(const std::string& key);
+
+    /*! Get value by key.
+     *
+     * \param[in] key The key to search in the object.
+     * \returns Value stored by the key.
+     * \throws std::out_of_range When the object doesn't contain the key.
+     */
+    KORA_API
+    const dynamic_t&
+    at(const std::string& key) const;
 
     /*! Get value by key.
      *
@@ -108,7 +472,12 @@ public:
     dynamic_t
     at(const std::string& key, dynamic_t&& default_) const;
 
-    using base_type::operator[];
+    /*! Get value by key, inserting null value if the object doesn't contain the key.
+     * \throws std::bad_alloc
+     */
+    KORA_API
+    dynamic_t&
+    operator[](const std::string& key);
 
     /*! Get value by key.
      *
@@ -119,8 +488,96 @@ public:
     KORA_API
     const dynamic_t&
     operator[](const std::string& key) const;
+
+private:
+    friend class dynamic_t;
+
+    friend bool operator==(const object_t& left, const object_t& right);
+    friend bool operator==(const object_t& left, const std::map<std::string, dynamic_t>& right);
+    friend bool operator==(const std::map<std::string, dynamic_t>& left, const object_t& right);
+
+    // Slot of the hash table. Empty slots have position equal to empty_slot.
+    struct slot_t {
+        size_t hash;
+        size_t position;
+    };
+
+    static const size_t empty_slot = static_cast<size_t>(-1);
+
+    bool
+    hashed() const KORA_NOEXCEPT {
+        return !m_index.empty();
+    }
+
+    KORA_API
+    std::pair<iterator, bool>
+    insert_item(item_type&& value);
+
+    // Appends the item to the hashed object, whose hash table already has room for it.
+    void
+    append_hashed(item_type&& value, size_t hash);
+
+    // Drops all but the first item of each key.
+    // Small objects get sorted by key, large ones keep the order of the items and build the hash table.
+    KORA_API
+    void
+    normalize();
+
+    // Returns position of the item with the key or empty_slot.
+    size_t
+    find_hashed(const std::string& key, size_t hash) const KORA_NOEXCEPT;
+
+    // Makes room in the hash table for \p size items.
+    void
+    reserve_index(size_t size);
+
+    void
+    add_slot(size_t hash, size_t position) KORA_NOEXCEPT;
+
+    // Updates the hash table before the items [first, last) are erased.
+    void
+    remove_slots(size_t first, size_t last) KORA_NOEXCEPT;
+
+    // Updates the hash table before the item at position \p from is moved to position \p to.
+    void
+    move_slot(size_t from, size_t to) KORA_NOEXCEPT;
+
+private:
+    items_type m_items;
+
+    // Hashes of the keys of m_items, so the slots of the erased and moved items are found without
+    // hashing their keys again. It's empty while the object isn't hashed.
+    std::vector<size_t> m_hashes;
+
+    // Hash table over m_items. It's empty while the object is smaller than hash_threshold.
+    std::vector<slot_t> m_index;
 };
 
+//! \returns \p true if both objects contain the same keys with equal values.
+KORA_API
+bool
+operator==(const dynamic_t::object_t& left, const dynamic_t::object_t& right);
+
+KORA_API
+bool
+operator!=(const dynamic_t::object_t& left, const dynamic_t::object_t& right);
+
+KORA_API
+bool
+operator==(const dynamic_t::object_t& left, const std::map<std::string, dynamic_t>& right);
+
+KORA_API
+bool
+operator==(const std::map<std::string, dynamic_t>& left, const dynamic_t::object_t& right);
+
+KORA_API
+bool
+operator!=(const dynamic_t::object_t& left, const std::map<std::string, dynamic_t>& right);
+
+KORA_API
+bool
+operator!=(const std::map<std::string, dynamic_t>& left, const dynamic_t::object_t& right);
+
 } // namespace kora
 
 #endif
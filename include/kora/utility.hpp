@@ -32,5 +32,6 @@ along with this program. If not, see <http://www.gnu.org/licenses/>.
 #include "kora/utility/underlying_type.hpp"
 #include "kora/utility/visibility.hpp"
 #include "kora/utility/make_unique.hpp"
+#include "kora/utility/string_view.hpp"
 
 #endif
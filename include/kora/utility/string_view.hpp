@@ -0,0 +1,123 @@
+/*
+Copyright (c) 2014 Andrey Goryachev <andrey.goryachev@gmail.com>
+Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+This file is part of Kora.
+
+Kora is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 3 of the License, or
+(at your option) any later version.
+
+Kora is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef KORA_UTILITY_STRING_VIEW_HPP
+#define KORA_UTILITY_STRING_VIEW_HPP
+
+#include "kora/utility/noexcept.hpp"
+
+#include <cstring>
+#include <ostream>
+#include <string>
+
+namespace kora {
+
+/*! Non-owning reference to a contiguous sequence of characters.
+ *
+ * It's a small subset of std::string_view available on compilers without C++17 support.
+ * The referenced characters must outlive the view.
+ */
+class string_view_t {
+public:
+    typedef const char *const_iterator;
+    typedef const_iterator iterator;
+
+    string_view_t() KORA_NOEXCEPT :
+        m_data(""),
+        m_size(0)
+    { }
+
+    string_view_t(const char *data, size_t size) KORA_NOEXCEPT :
+        m_data(data),
+        m_size(size)
+    { }
+
+    string_view_t(const char *data) KORA_NOEXCEPT :
+        m_data(data),
+        m_size(std::strlen(data))
+    { }
+
+    string_view_t(const std::string& string) KORA_NOEXCEPT :
+        m_data(string.data()),
+        m_size(string.size())
+    { }
+
+    const char*
+    data() const KORA_NOEXCEPT {
+        return m_data;
+    }
+
+    size_t
+    size() const KORA_NOEXCEPT {
+        return m_size;
+    }
+
+    bool
+    empty() const KORA_NOEXCEPT {
+        return m_size == 0;
+    }
+
+    const_iterator
+    begin() const KORA_NOEXCEPT {
+        return m_data;
+    }
+
+    const_iterator
+    end() const KORA_NOEXCEPT {
+        return m_data + m_size;
+    }
+
+    char
+    operator[](size_t index) const KORA_NOEXCEPT {
+        return m_data[index];
+    }
+
+    //! \throws std::bad_alloc
+    std::string
+    str() const {
+        return std::string(m_data, m_size);
+    }
+
+private:
+    const char *m_data;
+    size_t m_size;
+};
+
+inline
+bool
+operator==(const string_view_t& left, const string_view_t& right) KORA_NOEXCEPT {
+    return left.size() == right.size() && std::memcmp(left.data(), right.data(), left.size()) == 0;
+}
+
+inline
+bool
+operator!=(const string_view_t& left, const string_view_t& right) KORA_NOEXCEPT {
+    return !(left == right);
+}
+
+inline
+std::ostream&
+operator<<(std::ostream& stream, const string_view_t& value) {
+    return stream.write(value.data(), value.size());
+}
+
+} // namespace kora
+
+#endif
@@ -164,7 +164,7 @@ config_t::operator[](const std::string &name) const {
 size_t
 config_t::size() const {
     if (underlying_object().is_string()) {
-        return underlying_object().as_string().size();
+        return underlying_object().as_string_view().size();
     } else if (underlying_object().is_array()) {
         return underlying_object().as_array().size();
     } else if (underlying_object().is_object()) {
@@ -31,8 +31,14 @@ KORA_POP_VISIBILITY
 #include <algorithm>
 #include <cctype>
 #include <fstream>
+#include <iterator>
 #include <sstream>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 using namespace kora;
 
 class config_parser_t::implementation_t {
@@ -67,17 +73,6 @@ config_parser_t::operator=(const config_parser_t &other) {
     return *this;
 }
 
-config_t
-config_parser_t::open(const std::string &path) {
-    std::ifstream stream(path.c_str());
-
-    if (!stream) {
-        throw std::runtime_error("failed to open config file: '" + path + "'");
-    }
-
-    return parse(stream);
-}
-
 namespace {
 
 class logging_filter_t {
@@ -118,19 +113,79 @@ private:
     std::string m_log;
 };
 
-// Returns the last line and its position in the text.
-std::pair<std::string, size_t>
-get_last_line(const std::string& text) {
-    size_t line_offset = text.find_last_of('\n');
+// Read-only memory mapping of a regular file.
+class mapped_file_t {
+    KORA_NONCOPYABLE(mapped_file_t)
 
-    if (line_offset == std::string::npos) {
-        line_offset = 0;
-    } else {
-        line_offset++;
+public:
+    // Throws std::runtime_error if the file can't be opened.
+    // If the file can't be mapped, is_mapped() returns false. Files other than regular ones
+    // aren't even opened, because opening e.g. a named pipe takes the place of its reader.
+    explicit
+    mapped_file_t(const std::string& path) :
+        m_data(nullptr),
+        m_size(0),
+        m_mapped(false)
+    {
+        struct stat info;
+
+        if (::stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) {
+            return;
+        }
+
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+        if (fd == -1) {
+            throw std::runtime_error("failed to open config file: '" + path + "'");
+        }
+
+        // The path may be replaced with another file after the check.
+        if (::fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+            m_size = info.st_size;
+
+            if (m_size == 0) {
+                m_mapped = true;
+            } else {
+                void *data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+                if (data != MAP_FAILED) {
+                    ::madvise(data, m_size, MADV_SEQUENTIAL);
+
+                    m_data = static_cast<const char*>(data);
+                    m_mapped = true;
+                }
+            }
+        }
+
+        ::close(fd);
     }
 
-    return std::pair<std::string, size_t>(text.substr(line_offset), line_offset);
-}
+    ~mapped_file_t() {
+        if (m_data) {
+            ::munmap(const_cast<char*>(m_data), m_size);
+        }
+    }
+
+    bool
+    is_mapped() const {
+        return m_mapped;
+    }
+
+    const char*
+    data() const {
+        return m_data;
+    }
+
+    size_t
+    size() const {
+        return m_size;
+    }
+
+private:
+    const char *m_data;
+    size_t m_size;
+    bool m_mapped;
+};
 
 std::string
 complete_line(std::string log, size_t line_pointer, std::istream& input) {
@@ -152,18 +207,18 @@ complete_line(std::string log, size_t line_pointer, std::istream& input) {
 
 KORA_NORETURN
 void
-throw_parser_error(std::string&& config, size_t error_offset, const char *message) {
+throw_parser_error(size_t error_line_number,
+                   std::string error_line,
+                   size_t error_line_offset,
+                   size_t error_offset,
+                   const char *message)
+{
     /*
      * Produce a pretty output about the error
      * including the line and certain place where
      * the error occured.
      */
 
-    const size_t error_line_number = std::count(config.begin(), config.end(), '\n') + 1;
-
-    std::string error_line; size_t error_line_offset = 0;
-    std::tie(error_line, error_line_offset) = get_last_line(config);
-
     // Let's assume that the tab length is one for simplicity.
     std::replace(error_line.begin(), error_line.end(), '\t', ' ');
 
@@ -178,6 +233,41 @@ throw_parser_error(std::string&& config, size_t error_offset, const char *messag
     throw config_parser_error_t(error.str(), message, error_line_number, dash_count + 1);
 }
 
+// Expects [config, config + size) to end with the line containing the error.
+KORA_NORETURN
+void
+throw_parser_error(const char *config, size_t size, size_t error_offset, const char *message) {
+    const char *config_end = config + size;
+
+    // Find the last line and its position in the text.
+    const char *error_line_begin = config_end;
+
+    while (error_line_begin != config && *(error_line_begin - 1) != '\n') {
+        --error_line_begin;
+    }
+
+    throw_parser_error(std::count(config, config_end, '\n') + 1,
+                       std::string(error_line_begin, config_end),
+                       error_line_begin - config,
+                       error_offset,
+                       message);
+}
+
+KORA_NORETURN
+void
+throw_parser_error(const std::string& config, size_t error_offset, const char *message) {
+    throw_parser_error(config.data(), config.size(), error_offset, message);
+}
+
+// The same as above, but the config is the whole text, so the error line is found in place.
+KORA_NORETURN
+void
+throw_in_place_parser_error(const char *config, size_t size, size_t error_offset, const char *message) {
+    const char *end_of_error_line = std::find(config + std::min(error_offset, size), config + size, '\n');
+
+    throw_parser_error(config, end_of_error_line - config, error_offset, message);
+}
+
 bool
 isspace_predicate(char c) {
     return std::isspace(c);
@@ -185,9 +275,12 @@ isspace_predicate(char c) {
 
 } // namespace
 
-config_t
-config_parser_t::parse(std::istream &stream) {
-    std::unique_ptr<config_parser_t::implementation_t> new_data(new config_parser_t::implementation_t);
+namespace {
+
+// Logs all the input to be able to show the context of an error.
+dynamic_t
+read_logged_config(std::istream &stream) {
+    dynamic_t result;
 
     logging_filter_t filter;
     boost::iostreams::filtering_istream proxy_stream;
@@ -195,7 +288,7 @@ config_parser_t::parse(std::istream &stream) {
     proxy_stream.push(boost::ref(stream));
 
     try {
-        new_data->root = kora::dynamic::read_json(proxy_stream);
+        result = kora::dynamic::read_json(proxy_stream);
     } catch (const kora::json_parsing_error_t& e) {
         throw_parser_error(complete_line(std::move(filter.data()), e.offset(), stream),
                            e.offset(),
@@ -213,7 +306,7 @@ config_parser_t::parse(std::istream &stream) {
                            "The input shouldn't contain anything after the root object.");
     }
 
-    if (!new_data->root.is_object()) {
+    if (!result.is_object()) {
         auto json_start = std::find_if_not(filter.data().begin(), filter.data().end(), &isspace_predicate);
         size_t offset = json_start - filter.data().begin();
 
@@ -222,11 +315,133 @@ config_parser_t::parse(std::istream &stream) {
                            "The value must be an object.");
     }
 
+    return result;
+}
+
+// Re-reads the stream from the start up to the end of the line containing the error.
+KORA_NORETURN
+void
+throw_seekable_parser_error(std::istream &stream,
+                            std::istream::pos_type start,
+                            size_t error_offset,
+                            const char *message)
+{
+    stream.clear();
+    stream.seekg(start);
+
+    size_t error_line_number = 1;
+    size_t error_line_offset = 0;
+    std::string error_line;
+
+    while (std::getline(stream, error_line) && error_line_offset + error_line.size() < error_offset) {
+        error_line_offset += error_line.size() + 1;
+        ++error_line_number;
+    }
+
+    throw_parser_error(error_line_number, std::move(error_line), error_line_offset, error_offset, message);
+}
+
+// Reads the stream directly and seeks back to restore the context only if an error occurs.
+dynamic_t
+read_seekable_config(std::istream &stream, std::istream::pos_type start) {
+    dynamic_t result;
+
+    try {
+        result = kora::dynamic::read_json(stream);
+    } catch (const kora::json_parsing_error_t& e) {
+        throw_seekable_parser_error(stream, start, e.offset(), e.message());
+    }
+
+    // read_json() consumes the spaces after the value, so anything left is garbage.
+    if (!stream.eof()) {
+        size_t offset = stream.tellg() - start;
+
+        throw_seekable_parser_error(stream,
+                                    start,
+                                    offset,
+                                    "The input shouldn't contain anything after the root object.");
+    }
+
+    if (!result.is_object()) {
+        stream.clear();
+        stream.seekg(start);
+
+        std::istreambuf_iterator<char> it(stream), end;
+        size_t offset = 0;
+
+        for (; it != end && isspace_predicate(*it); ++it) {
+            ++offset;
+        }
+
+        throw_seekable_parser_error(stream, start, offset, "The value must be an object.");
+    }
+
+    return result;
+}
+
+} // namespace
+
+config_t
+config_parser_t::parse(std::istream &stream) {
+    std::unique_ptr<config_parser_t::implementation_t> new_data(new config_parser_t::implementation_t);
+
+    const std::istream::pos_type start = stream.tellg();
+
+    if (start == std::istream::pos_type(-1)) {
+        new_data->root = read_logged_config(stream);
+    } else {
+        new_data->root = read_seekable_config(stream, start);
+    }
+
+    m_impl = std::move(new_data);
+
+    return root();
+}
+
+config_t
+config_parser_t::parse(const char *data, size_t size) {
+    std::unique_ptr<config_parser_t::implementation_t> new_data(new config_parser_t::implementation_t);
+
+    size_t consumed = 0;
+
+    try {
+        new_data->root = kora::dynamic::read_json(data, size, &consumed);
+    } catch (const kora::json_parsing_error_t& e) {
+        throw_in_place_parser_error(data, size, e.offset(), e.message());
+    }
+
+    if (consumed != size) {
+        throw_in_place_parser_error(data, size, consumed, "The input shouldn't contain anything after the root object.");
+    }
+
+    if (!new_data->root.is_object()) {
+        size_t offset = std::find_if_not(data, data + size, &isspace_predicate) - data;
+
+        throw_in_place_parser_error(data, size, offset, "The value must be an object.");
+    }
+
     m_impl = std::move(new_data);
 
     return root();
 }
 
+config_t
+config_parser_t::open(const std::string &path) {
+    mapped_file_t file(path);
+
+    if (file.is_mapped()) {
+        return parse(file.data(), file.size());
+    }
+
+    std::ifstream stream(path.c_str());
+
+    if (!stream) {
+        throw std::runtime_error("failed to open config file: '" + path + "'");
+    }
+
+    return parse(stream);
+}
+
 config_t
 config_parser_t::root() const {
     if (m_impl) {
@@ -0,0 +1,266 @@
+/*
+    Copyright (c) 2013-2014 Andrey Goryachev <andrey.goryachev@gmail.com>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Kora.
+
+    Kora is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Kora is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "kora/dynamic/document.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+using namespace kora;
+
+namespace {
+
+// Hands out memory from large blocks and frees it only all at once.
+class arena_t {
+    KORA_NONCOPYABLE(arena_t)
+
+    static const size_t initial_block_size = 4096;
+    static const size_t max_block_size = 1024 * 1024;
+
+    struct block_t {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+public:
+    arena_t() :
+        m_current(nullptr),
+        m_left(0),
+        m_next_block_size(initial_block_size)
+    { }
+
+    void*
+    allocate(size_t size, size_t alignment) {
+        size_t padding = (alignment - reinterpret_cast<uintptr_t>(m_current) % alignment) % alignment;
+
+        if (padding + size > m_left) {
+            add_block(size + alignment);
+            padding = (alignment - reinterpret_cast<uintptr_t>(m_current) % alignment) % alignment;
+        }
+
+        char *result = m_current + padding;
+
+        m_current += padding + size;
+        m_left -= padding + size;
+
+        return result;
+    }
+
+    // Keeps only the largest block to reuse it.
+    void
+    release() KORA_NOEXCEPT {
+        if (m_blocks.empty()) {
+            return;
+        }
+
+        auto largest = m_blocks.begin();
+
+        for (auto it = m_blocks.begin() + 1; it != m_blocks.end(); ++it) {
+            if (it->size > largest->size) {
+                largest = it;
+            }
+        }
+
+        std::swap(*largest, m_blocks.front());
+        m_blocks.erase(m_blocks.begin() + 1, m_blocks.end());
+
+        m_current = m_blocks.front().data.get();
+        m_left = m_blocks.front().size;
+    }
+
+    size_t
+    capacity() const KORA_NOEXCEPT {
+        size_t result = 0;
+
+        for (auto it = m_blocks.begin(); it != m_blocks.end(); ++it) {
+            result += it->size;
+        }
+
+        return result;
+    }
+
+private:
+    void
+    add_block(size_t min_size) {
+        block_t block;
+        block.size = std::max(min_size, m_next_block_size);
+        block.data.reset(new char[block.size]);
+
+        m_blocks.push_back(std::move(block));
+
+        m_current = m_blocks.back().data.get();
+        m_left = m_blocks.back().size;
+        m_next_block_size = std::min(2 * m_next_block_size, static_cast<size_t>(max_block_size));
+    }
+
+private:
+    std::vector<block_t> m_blocks;
+    char *m_current;
+    size_t m_left;
+    size_t m_next_block_size;
+};
+
+// FNV-1a.
+struct string_view_hash_t {
+    size_t
+    operator()(const string_view_t& value) const KORA_NOEXCEPT {
+        uint64_t result = 14695981039346656037ULL;
+
+        for (auto it = value.begin(); it != value.end(); ++it) {
+            result ^= static_cast<unsigned char>(*it);
+            result *= 1099511628211ULL;
+        }
+
+        return static_cast<size_t>(result);
+    }
+};
+
+} // namespace
+
+class document_t::implementation_t {
+public:
+    implementation_t() :
+        interning(false)
+    { }
+
+    // The arena is declared first to outlive the values stored in it.
+    arena_t arena;
+    dynamic_t root;
+
+    // Views of the interned strings refer to the arena.
+    bool interning;
+    std::unordered_map<string_view_t, dynamic_t::arena_string_t*, string_view_hash_t> strings;
+};
+
+document_t::document_t() :
+    m_impl(new document_t::implementation_t)
+{ }
+
+document_t::~document_t() KORA_NOEXCEPT { }
+
+dynamic_t&
+document_t::root() KORA_NOEXCEPT {
+    return m_impl->root;
+}
+
+const dynamic_t&
+document_t::root() const KORA_NOEXCEPT {
+    return m_impl->root;
+}
+
+dynamic_t
+document_t::make_string(const string_view_t& value) {
+    if (value.size() <= dynamic_t::short_string_capacity) {
+        return dynamic_t(value);
+    }
+
+    typedef dynamic_t::arena_string_t arena_string_t;
+
+    if (m_impl->interning) {
+        auto it = m_impl->strings.find(value);
+
+        if (it != m_impl->strings.end()) {
+            dynamic_t result;
+            result.m_storage.common.value.arena_string_value = it->second;
+            result.m_storage.common.type = dynamic_t::arena_string_type;
+
+            return result;
+        }
+    }
+
+    void *memory = m_impl->arena.allocate(
+        offsetof(arena_string_t, data) + value.size() + 1,
+        std::alignment_of<arena_string_t>::value
+    );
+
+    arena_string_t *string = static_cast<arena_string_t*>(memory);
+    string->size = value.size();
+    std::copy(value.begin(), value.end(), string->data);
+    string->data[value.size()] = '\0';
+
+    if (m_impl->interning) {
+        m_impl->strings.insert(std::make_pair(string_view_t(string->data, string->size), string));
+    }
+
+    dynamic_t result;
+    result.m_storage.common.value.arena_string_value = string;
+    result.m_storage.common.type = dynamic_t::arena_string_type;
+
+    return result;
+}
+
+dynamic_t
+document_t::make_array(dynamic_t::array_t value) {
+    typedef dynamic_t::shared_t<dynamic_t::array_t> shared_array_t;
+
+    void *memory = m_impl->arena.allocate(sizeof(shared_array_t), std::alignment_of<shared_array_t>::value);
+
+    dynamic_t result;
+    result.m_storage.common.value.array_value = new(memory) shared_array_t(std::move(value));
+    result.m_storage.common.in_arena = true;
+    result.m_storage.common.type = dynamic_t::array_type;
+
+    return result;
+}
+
+dynamic_t
+document_t::make_object(dynamic_t::object_t value) {
+    typedef dynamic_t::shared_t<dynamic_t::object_t> shared_object_t;
+
+    void *memory = m_impl->arena.allocate(sizeof(shared_object_t), std::alignment_of<shared_object_t>::value);
+
+    dynamic_t result;
+    result.m_storage.common.value.object_value = new(memory) shared_object_t(std::move(value));
+    result.m_storage.common.in_arena = true;
+    result.m_storage.common.type = dynamic_t::object_type;
+
+    return result;
+}
+
+void
+document_t::set_string_interning(bool enabled) KORA_NOEXCEPT {
+    m_impl->interning = enabled;
+
+    if (!enabled) {
+        m_impl->strings.clear();
+    }
+}
+
+bool
+document_t::string_interning() const KORA_NOEXCEPT {
+    return m_impl->interning;
+}
+
+void
+document_t::clear() KORA_NOEXCEPT {
+    m_impl->root = dynamic_t::null_t();
+    m_impl->strings.clear();
+    m_impl->arena.release();
+}
+
+size_t
+document_t::capacity() const KORA_NOEXCEPT {
+    return m_impl->arena.capacity();
+}
@@ -20,6 +20,13 @@
 
 #include "kora/dynamic/dynamic.hpp"
 #include "kora/dynamic/error.hpp"
+#include "kora/dynamic/json.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
 
 using namespace kora;
 
@@ -28,55 +35,79 @@ const dynamic_t dynamic_t::empty_string = dynamic_t::string_t();
 const dynamic_t dynamic_t::empty_array = dynamic_t::array_t();
 const dynamic_t dynamic_t::empty_object = dynamic_t::object_t();
 
-// Should be applied directly to the underlying variant.
-struct dynamic_t::move_visitor:
-    public boost::static_visitor<>
-{
-    move_visitor(dynamic_t::value_t& destination) :
-        m_destination(destination)
-    { }
+namespace {
 
-    template<class T>
-    void
-    operator()(T& v) const {
-        m_destination = v;
+// The helpers take dynamic_t::shared_t<T> deduced from the pointer.
+
+template<class Shared>
+void
+release(Shared *shared, bool in_arena) KORA_NOEXCEPT {
+    if (in_arena) {
+        shared->~Shared();
+    } else if (shared->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete shared;
     }
+}
 
-    void
-    operator()(std::string& v) const {
-        m_destination = std::string();
-        boost::get<std::string>(m_destination) = std::move(v);
+// Copies the container if it's shared, so a mutable reference to it may be handed out.
+// After that it's never shared, and the saved hash is outdated.
+template<class Shared>
+void
+detach(Shared*& shared, bool in_arena) {
+    if (!in_arena && shared->references.load(std::memory_order_acquire) != 1) {
+        Shared *copy = new Shared(shared->value);
+        release(shared, false);
+        shared = copy;
     }
 
-    template<class T>
-    void
-    operator()(detail::dynamic::incomplete_wrapper<T>& v) const {
-        m_destination = detail::dynamic::incomplete_wrapper<T>();
-        boost::get<detail::dynamic::incomplete_wrapper<T>>(m_destination).set(v.release());
+    shared->unshareable = true;
+    shared->hash.store(0, std::memory_order_relaxed);
+}
+
+// The list of dead containers is linked through their reference counters, which aren't used anymore.
+// The lowest bit of a link marks objects, the next one marks containers placed in a document.
+const uintptr_t object_link = 1;
+const uintptr_t arena_link = 2;
+
+// Puts the container to the list if it's no longer referenced.
+template<class Shared>
+void
+bury(Shared *shared, bool in_arena, uintptr_t flag, uintptr_t& dead) KORA_NOEXCEPT {
+    if (in_arena || shared->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        shared->references.store(dead, std::memory_order_relaxed);
+        dead = reinterpret_cast<uintptr_t>(shared) | flag | (in_arena ? arena_link : 0);
     }
+}
 
-private:
-    dynamic_t::value_t& m_destination;
-};
+dynamic_t&
+item_value(dynamic_t& item) KORA_NOEXCEPT {
+    return item;
+}
 
-namespace {
+dynamic_t&
+item_value(const dynamic_t::object_t::reference& item) KORA_NOEXCEPT {
+    return item.second;
+}
 
-struct assign_visitor:
-    public boost::static_visitor<>
-{
-    assign_visitor(dynamic_t& destination) :
-        m_destination(destination)
-    { }
+// Destroys the first container of the list after burying its children.
+template<class Shared, class Bury>
+void
+destroy_first_dead(uintptr_t& dead, Bury& bury_value) KORA_NOEXCEPT {
+    Shared *shared = reinterpret_cast<Shared*>(dead & ~(object_link | arena_link));
+    const bool in_arena = (dead & arena_link) != 0;
 
-    template<class T>
-    void
-    operator()(T& v) const {
-        m_destination = v;
+    dead = shared->references.load(std::memory_order_relaxed);
+
+    for (auto it = shared->value.begin(); it != shared->value.end(); ++it) {
+        bury_value(item_value(*it));
     }
 
-private:
-    dynamic_t& m_destination;
-};
+    if (in_arena) {
+        shared->~Shared();
+    } else {
+        delete shared;
+    }
+}
 
 struct equals_visitor:
     public boost::static_visitor<bool>
@@ -130,17 +161,18 @@ struct equals_visitor:
 
     bool
     operator()(const dynamic_t::string_t& v) const {
-        return m_other.is_string() && m_other.as_string() == v;
+        return m_other.is_string() && m_other.as_string_view() == string_view_t(v);
     }
 
+    // Containers are compared by operator== without recursion.
     bool
-    operator()(const dynamic_t::array_t& v) const {
-        return m_other.is_array() && m_other.as_array() == v;
+    operator()(const dynamic_t::array_t&) const {
+        return false;
     }
 
     bool
-    operator()(const dynamic_t::object_t& v) const {
-        return m_other.is_object() && m_other.as_object() == v;
+    operator()(const dynamic_t::object_t&) const {
+        return false;
     }
 
 private:
@@ -150,144 +182,358 @@ private:
 } // namespace
 
 dynamic_t::dynamic_t() KORA_NOEXCEPT :
-    m_value(null_t())
+    m_storage()
 { }
 
 dynamic_t::dynamic_t(const dynamic_t& other) :
-    m_value(null_t())
-{
-    other.apply(assign_visitor(*this));
-}
-
-dynamic_t::dynamic_t(dynamic_t&& other) KORA_NOEXCEPT :
-    m_value(null_t())
+    m_storage(other.m_storage)
 {
-    boost::apply_visitor(dynamic_t::move_visitor(m_value), other.m_value);
+    // Copies never refer to the arena of a document.
+    switch (m_storage.common.type) {
+    case string_type:
+        m_storage.common.value.string_value = new string_t(*other.m_storage.common.value.string_value);
+        break;
+    case arena_string_type: {
+        const string_view_t value = other.as_string_view();
+        m_storage = make_string(value.data(), value.size());
+    } break;
+    case array_type:
+    case object_type:
+        if (!shareable(other)) {
+            m_storage = storage_t();
+            copy_unshareable(other);
+        } else if (m_storage.common.type == array_type) {
+            m_storage.common.value.array_value->references.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            m_storage.common.value.object_value->references.fetch_add(1, std::memory_order_relaxed);
+        }
+        break;
+    case json_text_type:
+        m_storage.common.value.json_text_value->references.fetch_add(1, std::memory_order_relaxed);
+        break;
+    default:
+        break;
+    }
 }
 
-dynamic_t::dynamic_t(dynamic_t::null_t value) KORA_NOEXCEPT :
-    m_value(value)
+dynamic_t::dynamic_t(dynamic_t::null_t) KORA_NOEXCEPT :
+    m_storage()
 { }
 
 dynamic_t::dynamic_t(dynamic_t::bool_t value) KORA_NOEXCEPT :
-    m_value(value)
-{ }
+    m_storage()
+{
+    m_storage.common.value.bool_value = value;
+    m_storage.common.type = bool_type;
+}
 
 dynamic_t::dynamic_t(dynamic_t::int_t value) KORA_NOEXCEPT :
-    m_value(value)
-{ }
+    m_storage()
+{
+    m_storage.common.value.int_value = value;
+    m_storage.common.type = int_type;
+}
 
 dynamic_t::dynamic_t(dynamic_t::uint_t value) KORA_NOEXCEPT :
-    m_value(value)
-{ }
+    m_storage()
+{
+    m_storage.common.value.uint_value = value;
+    m_storage.common.type = uint_type;
+}
 
 dynamic_t::dynamic_t(dynamic_t::double_t value) KORA_NOEXCEPT :
-    m_value(value)
-{ }
+    m_storage()
+{
+    m_storage.common.value.double_value = value;
+    m_storage.common.type = double_type;
+}
 
 dynamic_t::dynamic_t(const dynamic_t::string_t& value) :
-    m_value(value)
+    m_storage(make_string(value.data(), value.size()))
 { }
 
-dynamic_t::dynamic_t(dynamic_t::string_t&& value) KORA_NOEXCEPT :
-    m_value(dynamic_t::string_t())
-{
-    as_string() = std::move(value);
-}
+dynamic_t::dynamic_t(dynamic_t::string_t&& value) :
+    m_storage(make_string(std::move(value)))
+{ }
+
+dynamic_t::dynamic_t(const string_view_t& value) :
+    m_storage(make_string(value.data(), value.size()))
+{ }
 
 dynamic_t::dynamic_t(dynamic_t::array_t value) :
-    m_value(detail::dynamic::incomplete_wrapper<dynamic_t::array_t>())
+    m_storage()
 {
-    boost::get<detail::dynamic::incomplete_wrapper<dynamic_t::array_t>>(m_value).set(
-        new dynamic_t::array_t(std::move(value))
-    );
+    m_storage.common.value.array_value = new shared_t<array_t>(std::move(value));
+    m_storage.common.type = array_type;
 }
 
 dynamic_t::dynamic_t(dynamic_t::object_t value) :
-    m_value(detail::dynamic::incomplete_wrapper<dynamic_t::object_t>())
+    m_storage()
 {
-    boost::get<detail::dynamic::incomplete_wrapper<dynamic_t::object_t>>(m_value).set(
-        new dynamic_t::object_t(std::move(value))
-    );
+    m_storage.common.value.object_value = new shared_t<object_t>(std::move(value));
+    m_storage.common.type = object_type;
 }
 
-dynamic_t&
-dynamic_t::operator=(const dynamic_t& other) {
-    other.apply(assign_visitor(*this));
-    return *this;
+dynamic_t
+dynamic_t::make_json_text(std::shared_ptr<const std::string> buffer, const string_view_t& text) {
+    dynamic_t result;
+    result.m_storage.common.value.json_text_value = new shared_t<json_text_t>(std::move(buffer), text);
+    result.m_storage.common.type = json_text_type;
+
+    return result;
 }
 
 dynamic_t&
-dynamic_t::operator=(dynamic_t&& other) KORA_NOEXCEPT {
-    boost::apply_visitor(dynamic_t::move_visitor(m_value), other.m_value);
+dynamic_t::operator=(const dynamic_t& other) {
+    if (this != &other) {
+        *this = dynamic_t(other);
+    }
+
     return *this;
 }
 
 dynamic_t&
 dynamic_t::operator=(dynamic_t::null_t value) KORA_NOEXCEPT {
-    m_value = value;
-    return *this;
+    return *this = dynamic_t(value);
 }
 
 dynamic_t&
 dynamic_t::operator=(dynamic_t::bool_t value) KORA_NOEXCEPT {
-    m_value = value;
-    return *this;
+    return *this = dynamic_t(value);
 }
 
 dynamic_t&
 dynamic_t::operator=(dynamic_t::int_t value) KORA_NOEXCEPT {
-    m_value = value;
-    return *this;
+    return *this = dynamic_t(value);
 }
 
 dynamic_t&
 dynamic_t::operator=(dynamic_t::uint_t value) KORA_NOEXCEPT {
-    m_value = value;
-    return *this;
+    return *this = dynamic_t(value);
 }
 
 dynamic_t&
 dynamic_t::operator=(dynamic_t::double_t value) KORA_NOEXCEPT {
-    m_value = value;
-    return *this;
+    return *this = dynamic_t(value);
 }
 
 dynamic_t&
 dynamic_t::operator=(const dynamic_t::string_t& value) {
-    m_value = value;
+    reset(make_string(value.data(), value.size()));
     return *this;
 }
 
 dynamic_t&
-dynamic_t::operator=(dynamic_t::string_t&& value) KORA_NOEXCEPT {
-    m_value = dynamic_t::string_t();
-    as_string() = std::move(value);
+dynamic_t::operator=(dynamic_t::string_t&& value) {
+    reset(make_string(std::move(value)));
     return *this;
 }
 
 dynamic_t&
-dynamic_t::operator=(dynamic_t::array_t value) {
-    std::unique_ptr<dynamic_t::array_t> buffer(new dynamic_t::array_t(std::move(value)));
-    m_value = detail::dynamic::incomplete_wrapper<dynamic_t::array_t>();
-    boost::get<detail::dynamic::incomplete_wrapper<dynamic_t::array_t>>(m_value).set(buffer.release());
+dynamic_t::operator=(const string_view_t& value) {
+    reset(make_string(value.data(), value.size()));
     return *this;
 }
 
+dynamic_t&
+dynamic_t::operator=(dynamic_t::array_t value) {
+    return *this = dynamic_t(std::move(value));
+}
+
 dynamic_t&
 dynamic_t::operator=(dynamic_t::object_t value) {
-    std::unique_ptr<dynamic_t::object_t> buffer(new dynamic_t::object_t(std::move(value)));
-    m_value = detail::dynamic::incomplete_wrapper<dynamic_t::object_t>();
-    boost::get<detail::dynamic::incomplete_wrapper<dynamic_t::object_t>>(m_value).set(buffer.release());
-    return *this;
+    return *this = dynamic_t(std::move(value));
+}
+
+bool
+dynamic_t::shareable(const dynamic_t& value) KORA_NOEXCEPT {
+    const storage_t& storage = value.m_storage;
+
+    if (storage.common.type == array_type) {
+        return !storage.common.in_arena && !storage.common.value.array_value->unshareable;
+    } else if (storage.common.type == object_type) {
+        return !storage.common.in_arena && !storage.common.value.object_value->unshareable;
+    } else {
+        return true;
+    }
+}
+
+void
+dynamic_t::copy_unshareable(const dynamic_t& other) {
+    // Containers which can't be shared are copied into null placeholders, which are filled
+    // in the following iterations.
+
+    dynamic_t result;
+    std::vector<std::pair<dynamic_t*, const dynamic_t*>> pending(1, std::make_pair(&result, &other));
+
+    while (!pending.empty()) {
+        dynamic_t& to = *pending.back().first;
+        const dynamic_t& from = *pending.back().second;
+        pending.pop_back();
+
+        if (from.m_storage.common.type == array_type) {
+            const array_t& source = from.m_storage.common.value.array_value->value;
+
+            to.m_storage.common.value.array_value = new shared_t<array_t>();
+            to.m_storage.common.type = array_type;
+            to.m_storage.common.value.array_value->hash.store(
+                from.m_storage.common.value.array_value->hash.load(std::memory_order_relaxed),
+                std::memory_order_relaxed
+            );
+
+            // The placeholders don't move, because the memory is reserved.
+            array_t& array = to.m_storage.common.value.array_value->value;
+            array.reserve(source.size());
+
+            for (auto it = source.begin(); it != source.end(); ++it) {
+                if (!shareable(*it)) {
+                    array.emplace_back();
+                    pending.push_back(std::make_pair(&array.back(), &*it));
+                } else {
+                    array.push_back(*it);
+                }
+            }
+        } else {
+            const object_t& source = from.m_storage.common.value.object_value->value;
+
+            to.m_storage.common.value.object_value = new shared_t<object_t>();
+            to.m_storage.common.type = object_type;
+            to.m_storage.common.value.object_value->hash.store(
+                from.m_storage.common.value.object_value->hash.load(std::memory_order_relaxed),
+                std::memory_order_relaxed
+            );
+
+            // The items keep their order, so the hash table of the source may be copied as is.
+            object_t& object = to.m_storage.common.value.object_value->value;
+            object.m_items.reserve(source.size());
+
+            for (auto it = source.m_items.begin(); it != source.m_items.end(); ++it) {
+                if (!shareable(it->second)) {
+                    object.m_items.push_back(object_t::item_type(it->first, dynamic_t()));
+                    pending.push_back(std::make_pair(&object.m_items.back().second, &it->second));
+                } else {
+                    object.m_items.push_back(*it);
+                }
+            }
+
+            object.m_hashes = source.m_hashes;
+            object.m_index = source.m_index;
+        }
+    }
+
+    reset(result.m_storage);
+    result.m_storage.common.type = null_type;
+}
+
+dynamic_t::storage_t
+dynamic_t::make_string(const char *data, size_t size) {
+    storage_t storage = storage_t();
+
+    if (size <= short_string_capacity) {
+        std::copy(data, data + size, storage.short_string.data);
+        storage.short_string.unused = static_cast<unsigned char>(short_string_capacity - size);
+        storage.short_string.type = short_string_type;
+    } else {
+        storage.common.value.string_value = new string_t(data, size);
+        storage.common.type = string_type;
+    }
+
+    return storage;
+}
+
+dynamic_t::storage_t
+dynamic_t::make_string(dynamic_t::string_t&& value) {
+    if (value.size() <= short_string_capacity) {
+        return make_string(value.data(), value.size());
+    }
+
+    storage_t storage = storage_t();
+    storage.common.value.string_value = new string_t(std::move(value));
+    storage.common.type = string_type;
+
+    return storage;
+}
+
+const dynamic_t&
+dynamic_t::parse_json_text() const {
+    json_text_t& json = m_storage.common.value.json_text_value->value;
+
+    dynamic_t *parsed = json.parsed.load(std::memory_order_acquire);
+
+    if (!parsed) {
+        std::unique_ptr<dynamic_t> value(new dynamic_t(dynamic::read_json(json.text.data(), json.text.size())));
+
+        // Copies may be parsed by several threads at once. The first result is kept.
+        if (json.parsed.compare_exchange_strong(parsed, value.get(), std::memory_order_acq_rel)) {
+            parsed = value.release();
+        }
+    }
+
+    return *parsed;
+}
+
+// Moves the containers which are no longer referenced to the list of dead containers.
+class dynamic_t::shallow_destroyer_t {
+public:
+    explicit
+    shallow_destroyer_t(uintptr_t& dead) :
+        m_dead(dead)
+    { }
+
+    void
+    operator()(dynamic_t& value) KORA_NOEXCEPT {
+        bury_storage(value.m_storage);
+    }
+
+    void
+    bury_storage(storage_t& storage) KORA_NOEXCEPT {
+        if (storage.common.type == array_type) {
+            bury(storage.common.value.array_value, storage.common.in_arena, 0, m_dead);
+            storage.common.type = null_type;
+        } else if (storage.common.type == object_type) {
+            bury(storage.common.value.object_value, storage.common.in_arena, object_link, m_dead);
+            storage.common.type = null_type;
+        } else if (storage.common.type == json_text_type) {
+            // The parsed value is destroyed in the same way, but it contains no JSON text.
+            release(storage.common.value.json_text_value, false);
+            storage.common.type = null_type;
+        }
+    }
+
+private:
+    uintptr_t& m_dead;
+};
+
+void
+dynamic_t::destroy(const storage_t& storage) KORA_NOEXCEPT {
+    if (storage.common.type == string_type) {
+        delete storage.common.value.string_value;
+        return;
+    }
+
+    // Containers are destroyed without recursion, so deep trees don't overflow the stack.
+    // Before a container is destroyed, its unreferenced children are moved to the list of dead containers
+    // and replaced with nulls, so its destructor doesn't go deeper.
+    uintptr_t dead = 0;
+
+    shallow_destroyer_t destroyer(dead);
+
+    storage_t root = storage;
+    destroyer.bury_storage(root);
+
+    while (dead != 0) {
+        if (dead & object_link) {
+            destroy_first_dead<shared_t<object_t>>(dead, destroyer);
+        } else {
+            destroy_first_dead<shared_t<array_t>>(dead, destroyer);
+        }
+    }
 }
 
 dynamic_t::bool_t
 dynamic_t::as_bool() const {
-    auto ptr = boost::get<bool_t>(&m_value);
-
-    if (ptr) {
-        return *ptr;
+    if (is_bool()) {
+        return m_storage.common.value.bool_value;
     } else {
         throw expected_bool_t();
     }
@@ -295,10 +541,8 @@ dynamic_t::as_bool() const {
 
 dynamic_t::int_t
 dynamic_t::as_int() const {
-    auto ptr = boost::get<int_t>(&m_value);
-
-    if (ptr) {
-        return *ptr;
+    if (is_int()) {
+        return m_storage.common.value.int_value;
     } else {
         throw expected_int_t();
     }
@@ -306,10 +550,8 @@ dynamic_t::as_int() const {
 
 dynamic_t::uint_t
 dynamic_t::as_uint() const {
-    auto ptr = boost::get<uint_t>(&m_value);
-
-    if (ptr) {
-        return *ptr;
+    if (is_uint()) {
+        return m_storage.common.value.uint_value;
     } else {
         throw expected_uint_t();
     }
@@ -317,21 +559,32 @@ dynamic_t::as_uint() const {
 
 dynamic_t::double_t
 dynamic_t::as_double() const {
-    auto ptr = boost::get<double_t>(&m_value);
-
-    if (ptr) {
-        return *ptr;
+    if (is_double()) {
+        return m_storage.common.value.double_value;
     } else {
         throw expected_double_t();
     }
 }
 
-const dynamic_t::string_t&
+dynamic_t::string_t
 dynamic_t::as_string() const {
-    auto ptr = boost::get<string_t>(&m_value);
+    const string_view_t view = as_string_view();
+    return string_t(view.data(), view.size());
+}
 
-    if (ptr) {
-        return *ptr;
+string_view_t
+dynamic_t::as_string_view() const {
+    if (m_storage.common.type == short_string_type) {
+        return string_view_t(
+            m_storage.short_string.data,
+            short_string_capacity - m_storage.short_string.unused
+        );
+    } else if (m_storage.common.type == string_type) {
+        const string_t& value = *m_storage.common.value.string_value;
+        return string_view_t(value.data(), value.size());
+    } else if (m_storage.common.type == arena_string_type) {
+        const arena_string_t& value = *m_storage.common.value.arena_string_value;
+        return string_view_t(value.data, value.size);
     } else {
         throw expected_string_t();
     }
@@ -339,10 +592,10 @@ dynamic_t::as_string() const {
 
 const dynamic_t::array_t&
 dynamic_t::as_array() const {
-    auto ptr = boost::get<detail::dynamic::incomplete_wrapper<array_t>>(&m_value);
-
-    if (ptr) {
-        return ptr->get();
+    if (m_storage.common.type == array_type) {
+        return m_storage.common.value.array_value->value;
+    } else if (is_array()) {
+        return parse_json_text().as_array();
     } else {
         throw expected_array_t();
     }
@@ -350,10 +603,10 @@ dynamic_t::as_array() const {
 
 const dynamic_t::object_t&
 dynamic_t::as_object() const {
-    auto ptr = boost::get<detail::dynamic::incomplete_wrapper<object_t>>(&m_value);
-
-    if (ptr) {
-        return ptr->get();
+    if (m_storage.common.type == object_type) {
+        return m_storage.common.value.object_value->value;
+    } else if (is_object()) {
+        return parse_json_text().as_object();
     } else {
         throw expected_object_t();
     }
@@ -361,10 +614,17 @@ dynamic_t::as_object() const {
 
 dynamic_t::string_t&
 dynamic_t::as_string() {
-    auto ptr = boost::get<string_t>(&m_value);
+    if (m_storage.common.type == short_string_type || m_storage.common.type == arena_string_type) {
+        const string_view_t view = as_string_view();
+
+        storage_t storage = storage_t();
+        storage.common.value.string_value = new string_t(view.data(), view.size());
+        storage.common.type = string_type;
+        reset(storage);
+    }
 
-    if (ptr) {
-        return *ptr;
+    if (m_storage.common.type == string_type) {
+        return *m_storage.common.value.string_value;
     } else {
         throw expected_string_t();
     }
@@ -372,10 +632,15 @@ dynamic_t::as_string() {
 
 dynamic_t::array_t&
 dynamic_t::as_array() {
-    auto ptr = boost::get<detail::dynamic::incomplete_wrapper<array_t>>(&m_value);
+    if (is_array()) {
+        // The text would be outdated by modifications, so it's replaced with the parsed array.
+        if (m_storage.common.type == json_text_type) {
+            *this = dynamic_t(parse_json_text());
+        }
+
+        detach(m_storage.common.value.array_value, m_storage.common.in_arena);
 
-    if (ptr) {
-        return ptr->get();
+        return m_storage.common.value.array_value->value;
     } else {
         throw expected_array_t();
     }
@@ -383,61 +648,566 @@ dynamic_t::as_array() {
 
 dynamic_t::object_t&
 dynamic_t::as_object() {
-    auto ptr = boost::get<detail::dynamic::incomplete_wrapper<object_t>>(&m_value);
+    if (is_object()) {
+        if (m_storage.common.type == json_text_type) {
+            *this = dynamic_t(parse_json_text());
+        }
+
+        detach(m_storage.common.value.object_value, m_storage.common.in_arena);
 
-    if (ptr) {
-        return ptr->get();
+        return m_storage.common.value.object_value->value;
     } else {
         throw expected_object_t();
     }
 }
 
+dynamic_t::array_t&
+dynamic_t::emplace_array(size_t size_hint) {
+    std::unique_ptr<shared_t<array_t>> array(new shared_t<array_t>());
+    array->value.reserve(size_hint);
+    array->unshareable = true;
+
+    storage_t storage = storage_t();
+    storage.common.value.array_value = array.release();
+    storage.common.type = array_type;
+    reset(storage);
+
+    return m_storage.common.value.array_value->value;
+}
+
+dynamic_t::object_t&
+dynamic_t::emplace_object(size_t size_hint) {
+    std::unique_ptr<shared_t<object_t>> object(new shared_t<object_t>());
+    object->value.reserve(size_hint);
+    object->unshareable = true;
+
+    storage_t storage = storage_t();
+    storage.common.value.object_value = object.release();
+    storage.common.type = object_type;
+    reset(storage);
+
+    return m_storage.common.value.object_value->value;
+}
+
 bool
 dynamic_t::is_null() const KORA_NOEXCEPT {
-    return is<null_t>();
+    return m_storage.common.type == null_type;
 }
 
 bool
 dynamic_t::is_bool() const KORA_NOEXCEPT {
-    return is<bool_t>();
+    return m_storage.common.type == bool_type;
 }
 
 bool
 dynamic_t::is_int() const KORA_NOEXCEPT {
-    return is<int_t>();
+    return m_storage.common.type == int_type;
 }
 
 bool
 dynamic_t::is_uint() const KORA_NOEXCEPT {
-    return is<uint_t>();
+    return m_storage.common.type == uint_type;
 }
 
 bool
 dynamic_t::is_double() const KORA_NOEXCEPT {
-    return is<double_t>();
+    return m_storage.common.type == double_type;
 }
 
 bool
 dynamic_t::is_string() const KORA_NOEXCEPT {
-    return is<string_t>();
+    return m_storage.common.type == short_string_type ||
+           m_storage.common.type == string_type ||
+           m_storage.common.type == arena_string_type;
 }
 
 bool
 dynamic_t::is_array() const KORA_NOEXCEPT {
-    return is<detail::dynamic::incomplete_wrapper<array_t>>();
+    return m_storage.common.type == array_type ||
+           (m_storage.common.type == json_text_type && m_storage.common.value.json_text_value->value.text[0] == '[');
 }
 
 bool
 dynamic_t::is_object() const KORA_NOEXCEPT {
-    return is<detail::dynamic::incomplete_wrapper<object_t>>();
+    return m_storage.common.type == object_type ||
+           (m_storage.common.type == json_text_type && m_storage.common.value.json_text_value->value.text[0] == '{');
+}
+
+string_view_t
+dynamic_t::json_text() const KORA_NOEXCEPT {
+    if (m_storage.common.type == json_text_type) {
+        return m_storage.common.value.json_text_value->value.text;
+    } else {
+        return string_view_t();
+    }
 }
 
+namespace {
+
+// Pair of arrays or objects of the same size whose items are being compared.
+struct comparison_frame_t {
+    comparison_frame_t(const dynamic_t::array_t& left, const dynamic_t::array_t& right) :
+        left_item(left.data()),
+        left_end(left.data() + left.size()),
+        right_item(right.data()),
+        right_object(nullptr)
+    { }
+
+    comparison_frame_t(const dynamic_t::object_t& left, const dynamic_t::object_t& right) :
+        left_item(nullptr),
+        left_end(nullptr),
+        right_item(nullptr),
+        left_object_item(left.begin()),
+        left_object_end(left.end()),
+        right_object_item(right.begin()),
+        right_object(&right)
+    { }
+
+    // Arrays.
+    const dynamic_t *left_item;
+    const dynamic_t *left_end;
+    const dynamic_t *right_item;
+
+    // Objects, if right_object isn't null.
+    dynamic_t::object_t::const_iterator left_object_item;
+    dynamic_t::object_t::const_iterator left_object_end;
+    dynamic_t::object_t::const_iterator right_object_item;
+    const dynamic_t::object_t *right_object;
+};
+
+// Containers with different saved hashes aren't equal.
+template<class Shared>
 bool
-kora::operator==(const dynamic_t& left, const dynamic_t& right) KORA_NOEXCEPT {
-    return left.apply(equals_visitor(right));
+saved_hashes_may_be_equal(const Shared& left, const Shared& right) KORA_NOEXCEPT {
+    const uint64_t left_hash = left.hash.load(std::memory_order_relaxed);
+    const uint64_t right_hash = right.hash.load(std::memory_order_relaxed);
+
+    return left_hash == 0 || right_hash == 0 || left_hash == right_hash;
+}
+
+} // namespace
+
+// Compares two values and pushes the pairs of containers whose items have to be compared.
+class dynamic_t::shallow_comparator_t {
+public:
+    explicit
+    shallow_comparator_t(std::vector<comparison_frame_t>& stack) :
+        m_stack(stack)
+    { }
+
+    // JSON text is compared as the parsed value, unless both values have the same text.
+    // The text is checked when it's created, so the parsing may only throw std::bad_alloc.
+    bool
+    operator()(const dynamic_t& left, const dynamic_t& right) const {
+        const bool left_text = left.m_storage.common.type == json_text_type;
+        const bool right_text = right.m_storage.common.type == json_text_type;
+
+        if (!left_text && !right_text) {
+            return equal_parsed(left, right);
+        }
+
+        if (left_text && right_text && left.json_text() == right.json_text()) {
+            return true;
+        }
+
+        return equal_parsed(
+            left_text ? left.parse_json_text() : left,
+            right_text ? right.parse_json_text() : right
+        );
+    }
+
+private:
+    // Compares everything but the items of containers.
+    bool
+    equal_parsed(const dynamic_t& left, const dynamic_t& right) const {
+        const storage_t& left_storage = left.m_storage;
+        const storage_t& right_storage = right.m_storage;
+
+        switch (left_storage.common.type) {
+        case null_type:
+            return right_storage.common.type == null_type;
+        case bool_type:
+            return right_storage.common.type == bool_type &&
+                   left_storage.common.value.bool_value == right_storage.common.value.bool_value;
+        case short_string_type:
+        case string_type:
+        case arena_string_type:
+            return right.is_string() && left.as_string_view() == right.as_string_view();
+        case array_type: {
+            if (right_storage.common.type != array_type) {
+                return false;
+            }
+
+            const array_t& left_array = left_storage.common.value.array_value->value;
+            const array_t& right_array = right_storage.common.value.array_value->value;
+
+            if (left_array.size() != right_array.size()) {
+                return false;
+            }
+
+            const bool may_be_equal = saved_hashes_may_be_equal(
+                *left_storage.common.value.array_value,
+                *right_storage.common.value.array_value
+            );
+
+            if (!may_be_equal) {
+                return false;
+            }
+
+            // Containers shared by copies are equal to themselves.
+            if (!left_array.empty() && &left_array != &right_array) {
+                m_stack.push_back(comparison_frame_t(left_array, right_array));
+            }
+
+            return true;
+        }
+        case object_type: {
+            if (right_storage.common.type != object_type) {
+                return false;
+            }
+
+            const object_t& left_object = left_storage.common.value.object_value->value;
+            const object_t& right_object = right_storage.common.value.object_value->value;
+
+            if (left_object.size() != right_object.size()) {
+                return false;
+            }
+
+            const bool may_be_equal = saved_hashes_may_be_equal(
+                *left_storage.common.value.object_value,
+                *right_storage.common.value.object_value
+            );
+
+            if (!may_be_equal) {
+                return false;
+            }
+
+            if (!left_object.empty() && &left_object != &right_object) {
+                m_stack.push_back(comparison_frame_t(left_object, right_object));
+            }
+
+            return true;
+        }
+        default:
+            // Numbers of different types may be equal.
+            return left.apply(equals_visitor(right));
+        }
+    }
+
+private:
+    std::vector<comparison_frame_t>& m_stack;
+};
+
+bool
+kora::operator==(const dynamic_t& left, const dynamic_t& right) {
+    // Trees are traversed without recursion, so deep trees don't overflow the stack.
+    // Pairs of containers with items to compare are pushed to the stack.
+    std::vector<comparison_frame_t> stack;
+
+    dynamic_t::shallow_comparator_t shallow_equal(stack);
+
+    if (!shallow_equal(left, right)) {
+        return false;
+    }
+
+    while (!stack.empty()) {
+        comparison_frame_t& frame = stack.back();
+
+        const dynamic_t *left_item;
+        const dynamic_t *right_item;
+
+        if (!frame.right_object) {
+            if (frame.left_item == frame.left_end) {
+                stack.pop_back();
+                continue;
+            }
+
+            left_item = frame.left_item++;
+            right_item = frame.right_item++;
+        } else {
+            if (frame.left_object_item == frame.left_object_end) {
+                stack.pop_back();
+                continue;
+            }
+
+            // Objects of the same keys usually store them in the same order.
+            auto right_it = frame.right_object_item++;
+
+            if (right_it->first != frame.left_object_item->first) {
+                right_it = frame.right_object->find(frame.left_object_item->first);
+
+                if (right_it == frame.right_object->end()) {
+                    return false;
+                }
+            }
+
+            left_item = &(frame.left_object_item++)->second;
+            right_item = &right_it->second;
+        }
+
+        // The frame may be invalidated here.
+        if (!shallow_equal(*left_item, *right_item)) {
+            return false;
+        }
+    }
+
+    return true;
 }
 
 bool
-kora::operator!=(const dynamic_t& left, const dynamic_t& right) KORA_NOEXCEPT {
-    return !left.apply(equals_visitor(right));
+kora::operator!=(const dynamic_t& left, const dynamic_t& right) {
+    return !(left == right);
+}
+
+namespace {
+
+// Finalizer of MurmurHash3.
+uint64_t
+mix_hash(uint64_t value) KORA_NOEXCEPT {
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    value ^= value >> 33;
+
+    return value;
+}
+
+// MurmurHash64A, which reads eight bytes at a time.
+uint64_t
+hash_bytes(const char *data, size_t size, uint64_t seed) KORA_NOEXCEPT {
+    const uint64_t multiplier = 0xc6a4a7935bd1e995ULL;
+
+    uint64_t result = seed ^ (size * multiplier);
+
+    const char *end = data + size / 8 * 8;
+
+    for (; data != end; data += 8) {
+        uint64_t block;
+        std::memcpy(&block, data, 8);
+
+        block *= multiplier;
+        block ^= block >> 47;
+        block *= multiplier;
+
+        result ^= block;
+        result *= multiplier;
+    }
+
+    if (size % 8 != 0) {
+        uint64_t block = 0;
+        std::memcpy(&block, data, size % 8);
+
+        result ^= block;
+        result *= multiplier;
+    }
+
+    return mix_hash(result);
+}
+
+// Different seeds keep values of different types from having the same hashes.
+const uint64_t null_seed = 0x9e3779b97f4a7c15ULL;
+const uint64_t bool_seed = 0xbf58476d1ce4e5b9ULL;
+const uint64_t number_seed = 0x94d049bb133111ebULL;
+const uint64_t string_seed = 0x2545f4914f6cdd1dULL;
+const uint64_t array_seed = 0x9fb21c651e98df25ULL;
+const uint64_t object_seed = 0xd6e8feb86659fd93ULL;
+
+// Array or object whose items are being hashed.
+struct hash_frame_t {
+    hash_frame_t(const dynamic_t::array_t& array, std::atomic<uint64_t> *saved_hash) :
+        item(array.data()),
+        end(array.data() + array.size()),
+        object(nullptr),
+        saved_hash(saved_hash),
+        result(array_seed ^ array.size())
+    { }
+
+    hash_frame_t(const dynamic_t::object_t& object, std::atomic<uint64_t> *saved_hash) :
+        item(nullptr),
+        end(nullptr),
+        object_item(object.begin()),
+        object(&object),
+        saved_hash(saved_hash),
+        result(0)
+    { }
+
+    // Arrays.
+    const dynamic_t *item;
+    const dynamic_t *end;
+
+    // Objects, if object isn't null.
+    dynamic_t::object_t::const_iterator object_item;
+    const dynamic_t::object_t *object;
+
+    // Hash saved in the container when it's finished, or null if the hash mustn't be saved.
+    std::atomic<uint64_t> *saved_hash;
+
+    // Hash of the key of the item being hashed.
+    uint64_t key;
+
+    uint64_t result;
+
+    // Items of arrays are hashed in order. Hashes of the items of objects are summed up,
+    // so the order of the items doesn't matter.
+    void
+    add(uint64_t hash) KORA_NOEXCEPT {
+        if (!object) {
+            result = mix_hash(result ^ hash) + hash;
+        } else {
+            result += mix_hash(key ^ (hash * 0x9e3779b97f4a7c15ULL));
+        }
+    }
+
+    // Zero means unknown hash, so it's never returned.
+    uint64_t
+    finish() const KORA_NOEXCEPT {
+        const uint64_t hash = !object ? mix_hash(result) : mix_hash(result ^ object_seed ^ object->size());
+        return hash != 0 ? hash : 1;
+    }
+};
+
+// The hash isn't saved in unshareable containers: they may be modified through a reference at any time,
+// and so may their descendants. The ancestors of a value obtained through such references are
+// unshareable too, so no saved hash in the tree gets outdated by a modification.
+template<class Shared>
+std::atomic<uint64_t>*
+saved_hash(Shared *shared) KORA_NOEXCEPT {
+    return shared->unshareable ? nullptr : &shared->hash;
+}
+
+} // namespace
+
+// Hashes values, but only pushes containers without a saved hash to the stack.
+class dynamic_t::shallow_hasher_t {
+public:
+    explicit
+    shallow_hasher_t(std::vector<hash_frame_t>& stack) :
+        m_stack(stack)
+    { }
+
+    // Returns false and pushes a frame if the value is a container without a saved hash.
+    bool
+    operator()(const dynamic_t& value, uint64_t& hash) const {
+        const storage_t& storage = value.m_storage;
+
+        double_t number;
+
+        switch (storage.common.type) {
+        case null_type:
+            hash = null_seed;
+            return true;
+        case bool_type:
+            hash = mix_hash(bool_seed + storage.common.value.bool_value);
+            return true;
+        case short_string_type:
+        case string_type:
+        case arena_string_type: {
+            const string_view_t view = value.as_string_view();
+            hash = hash_bytes(view.data(), view.size(), string_seed);
+            return true;
+        }
+        case array_type:
+            hash = storage.common.value.array_value->hash.load(std::memory_order_relaxed);
+
+            if (hash == 0) {
+                m_stack.push_back(hash_frame_t(
+                    storage.common.value.array_value->value,
+                    saved_hash(storage.common.value.array_value)
+                ));
+            }
+
+            return hash != 0;
+        case object_type:
+            hash = storage.common.value.object_value->hash.load(std::memory_order_relaxed);
+
+            if (hash == 0) {
+                m_stack.push_back(hash_frame_t(
+                    storage.common.value.object_value->value,
+                    saved_hash(storage.common.value.object_value)
+                ));
+            }
+
+            return hash != 0;
+        case json_text_type:
+            // The parsed value saves its hash, so the text is hashed once.
+            // Equal values have equal hashes whether they are kept as text or not.
+            hash = hash_value(value.parse_json_text());
+
+            return true;
+        case int_type:
+            number = static_cast<double_t>(storage.common.value.int_value);
+            break;
+        case uint_type:
+            number = static_cast<double_t>(storage.common.value.uint_value);
+            break;
+        default:
+            number = storage.common.value.double_value;
+            break;
+        }
+
+        // Numbers equal by operator== are equal as doubles. Negative zero is equal to zero.
+        if (number == 0) {
+            number = 0;
+        }
+
+        uint64_t bits;
+        std::memcpy(&bits, &number, sizeof(bits));
+
+        hash = mix_hash(bits ^ number_seed);
+        return true;
+    }
+
+private:
+    std::vector<hash_frame_t>& m_stack;
+};
+
+size_t
+kora::hash_value(const dynamic_t& value) {
+    // Trees are traversed without recursion, like in operator==.
+    // The hashes of containers are saved in them, so hashing the tree again takes constant time.
+    std::vector<hash_frame_t> stack;
+
+    dynamic_t::shallow_hasher_t shallow_hash(stack);
+
+    uint64_t hash;
+
+    if (shallow_hash(value, hash)) {
+        return static_cast<size_t>(hash);
+    }
+
+    while (true) {
+        hash_frame_t& frame = stack.back();
+
+        const dynamic_t *item;
+
+        if (!frame.object) {
+            item = frame.item != frame.end ? frame.item++ : nullptr;
+        } else if (frame.object_item != frame.object->end()) {
+            const dynamic_t::string_t& key = frame.object_item->first;
+            frame.key = hash_bytes(key.data(), key.size(), string_seed);
+            item = &(frame.object_item++)->second;
+        } else {
+            item = nullptr;
+        }
+
+        if (!item) {
+            hash = frame.finish();
+
+            if (frame.saved_hash) {
+                frame.saved_hash->store(hash, std::memory_order_relaxed);
+            }
+
+            stack.pop_back();
+
+            if (stack.empty()) {
+                return static_cast<size_t>(hash);
+            }
+
+            stack.back().add(hash);
+        } else if (shallow_hash(*item, hash)) {
+            // The frame may be invalidated by a push, so it's only used when nothing was pushed.
+            frame.add(hash);
+        }
+    }
 }
@@ -40,6 +40,18 @@ json_parsing_error_t::message() const KORA_NOEXCEPT {
     return m_message.data();
 }
 
+json_path_error_t::json_path_error_t(const std::string& path, size_t offset) :
+    std::invalid_argument("incorrect path '" + path + "' at offset " + std::to_string(offset)),
+    m_offset(offset)
+{ }
+
+json_path_error_t::~json_path_error_t() KORA_NOEXCEPT { }
+
+size_t
+json_path_error_t::offset() const KORA_NOEXCEPT {
+    return m_offset;
+}
+
 bad_cast_t::~bad_cast_t() KORA_NOEXCEPT { }
 
 expected_null_t::~expected_null_t() KORA_NOEXCEPT { }
@@ -19,6 +19,7 @@
 */
 
 #include "kora/dynamic/constructors.hpp"
+#include "kora/dynamic/document.hpp"
 #include "kora/dynamic/error.hpp"
 #include "kora/dynamic/json.hpp"
 
@@ -27,327 +28,2184 @@
 #include <rapidjson/prettywriter.h>
 
 #include <algorithm>
-#include <stack>
-#include <sstream>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <vector>
 
 using namespace kora;
 
+namespace kora {
+
+// Lets the lazy reader create JSON text which it has already checked.
+struct json_reader_access_t {
+    static
+    dynamic_t
+    make_json_text(std::shared_ptr<const std::string> buffer, const string_view_t& text) {
+        return dynamic_t::make_json_text(std::move(buffer), text);
+    }
+};
+
+} // namespace kora
+
 namespace {
 
+// Builds the tree in place on a contiguous stack of values.
+// Containers take their items from the top of the stack by moving them.
+// If a document is given, string values and containers are allocated in it. Keys end up in
+// std::string keys of object_t anyway, so they are built as regular strings.
 struct json_to_dynamic_reader_t {
+    json_to_dynamic_reader_t() :
+        m_document(nullptr)
+    { }
+
     void
     Null() {
-        m_stack.emplace(dynamic_t::null);
+        m_stack.emplace_back();
     }
 
     void
     Bool(bool v) {
-        m_stack.emplace(v);
+        m_stack.emplace_back(v);
     }
 
     void
     Int(int v) {
-        m_stack.emplace(v);
+        m_stack.emplace_back(v);
     }
 
     void
     Uint(unsigned v) {
-        m_stack.emplace(v);
+        m_stack.emplace_back(v);
     }
 
     void
     Int64(int64_t v) {
-        m_stack.emplace(v);
+        m_stack.emplace_back(v);
     }
 
     void
     Uint64(uint64_t v) {
-        m_stack.emplace(v);
+        m_stack.emplace_back(v);
     }
 
     void
     Double(double v) {
-        m_stack.emplace(v);
+        m_stack.emplace_back(v);
     }
 
     void
     String(const char* data, size_t size, bool) {
-        m_stack.emplace(dynamic_t::string_t(data, size));
+        if (m_document && !expecting_key()) {
+            m_stack.emplace_back(m_document->make_string(string_view_t(data, size)));
+        } else {
+            m_stack.emplace_back(string_view_t(data, size));
+        }
     }
 
     void
     StartObject() {
-        // Empty.
+        if (m_document) {
+            m_containers.push_back(m_stack.size());
+        }
     }
 
     void
     EndObject(size_t size) {
-        dynamic_t::object_t object;
-
-        for (size_t i = 0; i < size; ++i) {
-            dynamic_t value = std::move(m_stack.top());
-            m_stack.pop();
+        if (m_document) {
+            m_containers.pop_back();
+        }
 
-            std::string key = std::move(m_stack.top().as_string());
-            m_stack.pop();
+        auto first = m_stack.end() - 2 * size;
 
-            object[key] = std::move(value);
+        dynamic_t::object_t object;
+        object.reserve(size);
+
+        // Small objects are written by kora with sorted keys, and large ones are appended to anyway,
+        // so inserting at the end is the most likely case.
+        // If a key is repeated, the first value wins.
+        // Short keys are stored inline, so they are copied from the view. Long keys are moved.
+        for (auto it = first; it != m_stack.end(); it += 2) {
+            const string_view_t key = it->as_string_view();
+
+            if (key.size() > dynamic_t::short_string_capacity) {
+                object.insert(object.end(), std::make_pair(std::move(it->as_string()), std::move(*(it + 1))));
+            } else {
+                object.insert(object.end(), std::make_pair(
+                    dynamic_t::string_t(key.data(), key.size()),
+                    std::move(*(it + 1))
+                ));
+            }
         }
 
-        m_stack.emplace(std::move(object));
+        m_stack.erase(first, m_stack.end());
+
+        if (m_document) {
+            m_stack.emplace_back(m_document->make_object(std::move(object)));
+        } else {
+            m_stack.emplace_back(std::move(object));
+        }
     }
 
     void
     StartArray() {
-        // Empty.
+        if (m_document) {
+            m_containers.push_back(static_cast<size_t>(array_start));
+        }
     }
 
     void
     EndArray(size_t size) {
-        dynamic_t::array_t array(size);
+        if (m_document) {
+            m_containers.pop_back();
+        }
+
+        auto first = m_stack.end() - size;
+
+        dynamic_t::array_t array(std::make_move_iterator(first), std::make_move_iterator(m_stack.end()));
 
-        for (size_t i = size; i != 0; --i) {
-            array[i - 1] = std::move(m_stack.top());
-            m_stack.pop();
+        m_stack.erase(first, m_stack.end());
+
+        if (m_document) {
+            m_stack.emplace_back(m_document->make_array(std::move(array)));
+        } else {
+            m_stack.emplace_back(std::move(array));
         }
+    }
 
-        m_stack.emplace(std::move(array));
+    // Pushes a value created outside of the reader.
+    void
+    Value(dynamic_t&& value) {
+        m_stack.push_back(std::move(value));
     }
 
     dynamic_t
     Result() {
-        return m_stack.top();
+        dynamic_t result = std::move(m_stack.back());
+        m_stack.pop_back();
+        return result;
+    }
+
+    // Drops the values left after a failed parsing, but keeps the memory.
+    void
+    Reset(document_t *document) {
+        m_stack.clear();
+        m_containers.clear();
+        m_document = document;
+    }
+
+    // The projection uses the stack to build the selected part of the tree,
+    // and drops the values which turn out not to lead to selected ones.
+    size_t
+    Size() const {
+        return m_stack.size();
+    }
+
+    void
+    Truncate(size_t size) {
+        m_stack.erase(m_stack.begin() + size, m_stack.end());
+    }
+
+private:
+    static const size_t array_start = static_cast<size_t>(-1);
+
+    // Keys and values alternate on the stack since the start of the object.
+    bool
+    expecting_key() const {
+        return !m_containers.empty() &&
+               m_containers.back() != array_start &&
+               (m_stack.size() - m_containers.back()) % 2 == 0;
     }
 
 private:
-    std::stack<dynamic_t> m_stack;
+    std::vector<dynamic_t> m_stack;
+    document_t *m_document;
+
+    // Positions on the stack where the open containers start, or array_start for arrays.
+    // They are only tracked for documents, other readers don't distinguish keys.
+    std::vector<size_t> m_containers;
 };
 
-struct rapidjson_istream_t {
-    rapidjson_istream_t(std::istream *backend) :
-        m_backend(backend),
-        m_offset(0)
+// Passes the events of rapidjson to json_handler_t.
+// rapidjson reports the keys of objects as strings, so the reader remembers whether a key is expected
+// in each open container.
+class json_event_reader_t {
+    enum container_t {
+        array_container,
+        object_expecting_key,
+        object_expecting_value
+    };
+
+public:
+    json_event_reader_t() :
+        m_handler(nullptr)
     { }
 
-    char
-    Peek() const {
-        int next = m_backend->peek();
+    void
+    Null() {
+        start_value();
+        m_handler->null();
+    }
 
-        if (next == std::char_traits<char>::eof()) {
-            return '\0';
-        } else {
-            return next;
-        }
+    void
+    Bool(bool v) {
+        start_value();
+        m_handler->boolean(v);
     }
 
-    char
-    Take() {
-        int next = m_backend->get();
+    void
+    Int(int v) {
+        start_value();
+        m_handler->integer(v);
+    }
 
-        if (next == std::char_traits<char>::eof()) {
-            return '\0';
+    void
+    Uint(unsigned v) {
+        start_value();
+        m_handler->unsigned_integer(v);
+    }
+
+    void
+    Int64(int64_t v) {
+        start_value();
+        m_handler->integer(v);
+    }
+
+    void
+    Uint64(uint64_t v) {
+        start_value();
+        m_handler->unsigned_integer(v);
+    }
+
+    void
+    Double(double v) {
+        start_value();
+        m_handler->floating_point(v);
+    }
+
+    void
+    String(const char* data, size_t size, bool) {
+        if (!m_containers.empty() && m_containers.back() == object_expecting_key) {
+            m_containers.back() = object_expecting_value;
+            m_handler->key(string_view_t(data, size));
         } else {
-            ++m_offset;
-            return next;
+            start_value();
+            m_handler->string(string_view_t(data, size));
         }
     }
 
-    size_t
-    Tell() const {
-        return m_offset;
+    void
+    StartObject() {
+        start_value();
+        m_containers.push_back(object_expecting_key);
+        m_handler->start_object();
     }
 
-    char*
-    PutBegin() {
-        assert(false);
-        return 0;
+    void
+    EndObject(size_t size) {
+        m_containers.pop_back();
+        m_handler->finish_object(size);
     }
 
     void
-    Put(char) {
-        assert(false);
+    StartArray() {
+        start_value();
+        m_containers.push_back(array_container);
+        m_handler->start_array();
     }
 
-    size_t
-    PutEnd(char*) {
-        assert(false);
-        return 0;
+    void
+    EndArray(size_t size) {
+        m_containers.pop_back();
+        m_handler->finish_array(size);
+    }
+
+    void
+    Reset(json_handler_t *handler) {
+        m_containers.clear();
+        m_handler = handler;
+    }
+
+private:
+    // A value of an object is followed by the next key.
+    void
+    start_value() {
+        if (!m_containers.empty() && m_containers.back() == object_expecting_value) {
+            m_containers.back() = object_expecting_key;
+        }
     }
 
 private:
-    std::istream *m_backend;
-    size_t m_offset;
+    std::vector<container_t> m_containers;
+    json_handler_t *m_handler;
 };
 
-struct rapidjson_ostream_t {
-    rapidjson_ostream_t(std::ostream *backend) :
-        m_backend(backend)
+// Tree of the paths of a projection. Each node selects the values of a container by keys and indexes.
+class path_tree_t {
+public:
+    static const size_t no_node = static_cast<size_t>(-1);
+
+    struct node_t {
+        node_t() :
+            selected(false),
+            any_key(no_node),
+            any_index(no_node)
+        { }
+
+        // The whole value is selected, so the children don't matter.
+        bool selected;
+
+        std::vector<std::pair<std::string, size_t>> keys;
+        std::vector<std::pair<size_t, size_t>> indexes;
+        size_t any_key;
+        size_t any_index;
+    };
+
+    path_tree_t() :
+        m_nodes(1)
     { }
 
-    char
-    Peek() const {
-        assert(false);
+    // The root of the JSON.
+    size_t
+    root() const KORA_NOEXCEPT {
         return 0;
     }
 
-    char
-    Take() {
-        assert(false);
-        return 0;
+    bool
+    selected(size_t node) const KORA_NOEXCEPT {
+        return m_nodes[node].selected;
     }
 
     size_t
-    Tell() const {
-        assert(false);
-        return 0;
+    key_child(size_t node, const string_view_t& key) const KORA_NOEXCEPT {
+        const node_t& parent = m_nodes[node];
+
+        for (auto it = parent.keys.begin(); it != parent.keys.end(); ++it) {
+            if (string_view_t(it->first) == key) {
+                return it->second;
+            }
+        }
+
+        return parent.any_key;
     }
 
-    char*
-    PutBegin() {
-        assert(false);
-        return 0;
+    size_t
+    index_child(size_t node, size_t index) const KORA_NOEXCEPT {
+        const node_t& parent = m_nodes[node];
+
+        for (auto it = parent.indexes.begin(); it != parent.indexes.end(); ++it) {
+            if (it->first == index) {
+                return it->second;
+            }
+        }
+
+        return parent.any_index;
     }
 
     void
-    Put(char c) {
-        m_backend->put(c);
+    add(const std::string& path) {
+        size_t node = root();
+        size_t position = 0;
+
+        if (position < path.size() && path[position] == '$') {
+            ++position;
+        }
+
+        while (position < path.size()) {
+            const size_t step_start = position;
+
+            if (path[position] == '[') {
+                const size_t end = path.find(']', position);
+
+                if (end == std::string::npos || end == position + 1) {
+                    throw json_path_error_t(path, step_start);
+                }
+
+                if (end == position + 2 && path[position + 1] == '*') {
+                    node = any_child(node, &node_t::any_index);
+                } else {
+                    size_t index = 0;
+
+                    for (size_t i = position + 1; i < end; ++i) {
+                        if (path[i] < '0' || path[i] > '9') {
+                            throw json_path_error_t(path, i);
+                        }
+
+                        index = index * 10 + (path[i] - '0');
+                    }
+
+                    node = child(node, &node_t::indexes, index);
+                }
+
+                position = end + 1;
+            } else {
+                // The dot may be omitted before the first key.
+                if (path[position] == '.') {
+                    ++position;
+                } else if (step_start != 0) {
+                    throw json_path_error_t(path, step_start);
+                }
+
+                const size_t end = std::min(path.find_first_of(".[]", position), path.size());
+
+                if (end == position) {
+                    throw json_path_error_t(path, position);
+                }
+
+                if (end == position + 1 && path[position] == '*') {
+                    node = any_child(node, &node_t::any_key);
+                } else {
+                    node = child(node, &node_t::keys, path.substr(position, end - position));
+                }
+
+                position = end;
+            }
+        }
+
+        m_nodes[node].selected = true;
+    }
+
+    // Wildcards apply to the keys and indexes listed explicitly too,
+    // so their subtrees are merged into the explicit children.
+    void
+    finish() {
+        finish(root());
     }
 
+private:
+    template<class Key>
     size_t
-    PutEnd(char*) {
-        assert(false);
-        return 0;
+    child(size_t node, std::vector<std::pair<Key, size_t>> node_t::*children, const Key& key) {
+        for (auto it = (m_nodes[node].*children).begin(); it != (m_nodes[node].*children).end(); ++it) {
+            if (it->first == key) {
+                return it->second;
+            }
+        }
+
+        m_nodes.push_back(node_t());
+        (m_nodes[node].*children).push_back(std::make_pair(key, m_nodes.size() - 1));
+
+        return m_nodes.size() - 1;
+    }
+
+    size_t
+    any_child(size_t node, size_t node_t::*child) {
+        if (m_nodes[node].*child == no_node) {
+            m_nodes.push_back(node_t());
+            m_nodes[node].*child = m_nodes.size() - 1;
+        }
+
+        return m_nodes[node].*child;
+    }
+
+    // Adds the paths of the source subtree to the destination one.
+    void
+    merge(size_t destination, size_t source) {
+        m_nodes[destination].selected = m_nodes[destination].selected || m_nodes[source].selected;
+
+        // The children may be added while iterating, so they are accessed by indexes.
+        for (size_t i = 0; i < m_nodes[source].keys.size(); ++i) {
+            const std::pair<std::string, size_t> item = m_nodes[source].keys[i];
+            merge(child(destination, &node_t::keys, item.first), item.second);
+        }
+
+        for (size_t i = 0; i < m_nodes[source].indexes.size(); ++i) {
+            const std::pair<size_t, size_t> item = m_nodes[source].indexes[i];
+            merge(child(destination, &node_t::indexes, item.first), item.second);
+        }
+
+        if (m_nodes[source].any_key != no_node) {
+            merge(any_child(destination, &node_t::any_key), m_nodes[source].any_key);
+        }
+
+        if (m_nodes[source].any_index != no_node) {
+            merge(any_child(destination, &node_t::any_index), m_nodes[source].any_index);
+        }
+    }
+
+    void
+    finish(size_t node) {
+        if (m_nodes[node].selected) {
+            return;
+        }
+
+        for (size_t i = 0; i < m_nodes[node].keys.size(); ++i) {
+            if (m_nodes[node].any_key != no_node) {
+                merge(m_nodes[node].keys[i].second, m_nodes[node].any_key);
+            }
+
+            finish(m_nodes[node].keys[i].second);
+        }
+
+        for (size_t i = 0; i < m_nodes[node].indexes.size(); ++i) {
+            if (m_nodes[node].any_index != no_node) {
+                merge(m_nodes[node].indexes[i].second, m_nodes[node].any_index);
+            }
+
+            finish(m_nodes[node].indexes[i].second);
+        }
+
+        if (m_nodes[node].any_key != no_node) {
+            finish(m_nodes[node].any_key);
+        }
+
+        if (m_nodes[node].any_index != no_node) {
+            finish(m_nodes[node].any_index);
+        }
     }
 
 private:
-    std::ostream *m_backend;
+    std::vector<node_t> m_nodes;
 };
 
-typedef rapidjson::Writer<rapidjson_ostream_t> ostream_simple_writer_t;
-typedef rapidjson::PrettyWriter<rapidjson_ostream_t> ostream_pretty_writer_t;
-
-template<class Writer>
-struct to_stream_visitor:
-    public boost::static_visitor<>
+// Builds the part of the tree selected by the paths.
+// The selected values are built by json_to_dynamic_reader_t as usual. The containers on the paths to them
+// are built on the same stack, and the items which don't lead to selected values are dropped from it.
+// Other values are skipped.
+class json_projection_reader_t:
+    public json_handler_t
 {
-    to_stream_visitor(Writer *writer) :
-        m_writer(writer)
+    // Container on a path to selected values.
+    struct frame_t {
+        size_t node;
+        bool object;
+
+        // Size of the stack before the container and the key or the nulls preceding it.
+        size_t mark;
+
+        // Number of the items built, including the nulls in place of skipped items of arrays.
+        size_t size;
+
+        // Index of the next item of an array.
+        size_t next_index;
+    };
+
+public:
+    json_projection_reader_t() :
+        m_paths(nullptr)
     { }
 
     void
-    operator()(const dynamic_t::null_t&) const {
-        m_writer->Null();
+    Reset(const path_tree_t *paths) {
+        m_paths = paths;
+        m_builder.Reset(nullptr);
+        m_frames.clear();
+        m_skipped = 0;
+        m_selected = 0;
+        m_key_node = path_tree_t::no_node;
+    }
+
+    dynamic_t
+    Result() {
+        return m_builder.Size() > 0 ? m_builder.Result() : dynamic_t();
     }
 
     void
-    operator()(const dynamic_t::bool_t& v) const {
-        m_writer->Bool(v);
+    null() {
+        if (start_scalar()) {
+            m_builder.Null();
+            finish_value();
+        }
     }
 
     void
-    operator()(const dynamic_t::int_t& v) const {
-        m_writer->Int64(v);
+    boolean(dynamic_t::bool_t value) {
+        if (start_scalar()) {
+            m_builder.Bool(value);
+            finish_value();
+        }
     }
 
     void
-    operator()(const dynamic_t::uint_t& v) const {
-        m_writer->Uint64(v);
+    integer(dynamic_t::int_t value) {
+        if (start_scalar()) {
+            m_builder.Int64(value);
+            finish_value();
+        }
     }
 
     void
-    operator()(const dynamic_t::double_t& v) const {
-        m_writer->Double(v);
+    unsigned_integer(dynamic_t::uint_t value) {
+        if (start_scalar()) {
+            m_builder.Uint64(value);
+            finish_value();
+        }
     }
 
     void
-    operator()(const dynamic_t::string_t& v) const {
-        m_writer->String(v.data(), v.size());
+    floating_point(dynamic_t::double_t value) {
+        if (start_scalar()) {
+            m_builder.Double(value);
+            finish_value();
+        }
     }
 
     void
-    operator()(const dynamic_t::array_t& v) const {
-        m_writer->StartArray();
+    string(const string_view_t& value) {
+        if (start_scalar()) {
+            m_builder.String(value.data(), value.size(), true);
+            finish_value();
+        }
+    }
 
-        for (auto it = v.begin(); it != v.end(); ++it) {
-            it->apply(*this);
+    void
+    key(const string_view_t& value) {
+        if (m_skipped > 0) {
+            return;
+        } else if (m_selected > 0) {
+            m_builder.String(value.data(), value.size(), true);
+            return;
         }
 
-        m_writer->EndArray();
+        // Only the keys leading to selected values are stored.
+        m_key_mark = m_builder.Size();
+        m_key_node = m_paths->key_child(m_frames.back().node, value);
+
+        if (m_key_node != path_tree_t::no_node) {
+            m_builder.String(value.data(), value.size(), true);
+        }
     }
 
     void
-    operator()(const dynamic_t::object_t& v) const {
-        m_writer->StartObject();
+    start_array() {
+        start_container(false);
+    }
 
-        for (auto it = v.begin(); it != v.end(); ++it) {
-            m_writer->String(it->first.data(), it->first.size());
-            it->second.apply(*this);
-        }
+    void
+    finish_array(size_t size) {
+        finish_container(false, size);
+    }
 
-        m_writer->EndObject();
+    void
+    start_object() {
+        start_container(true);
     }
 
-private:
-    Writer *m_writer;
-};
+    void
+    finish_object(size_t size) {
+        finish_container(true, size);
+    }
 
-} // namespace
+private:
+    // Finds the node of the value being started. The stack is prepared to receive the value if it may be
+    // selected, and its previous size is returned in mark.
+    size_t
+    start_value(size_t& mark) {
+        if (m_frames.empty()) {
+            mark = 0;
+            return m_paths->root();
+        }
 
-dynamic_t
-kora::dynamic::read_json(std::istream &input) {
-    rapidjson::MemoryPoolAllocator<> json_allocator;
-    rapidjson::Reader json_reader(&json_allocator);
-    rapidjson_istream_t json_stream(&input);
+        frame_t& frame = m_frames.back();
 
-    json_to_dynamic_reader_t configuration_constructor;
+        if (frame.object) {
+            mark = m_key_mark;
+            return m_key_node;
+        }
 
-    bool parse_success = json_reader.Parse<rapidjson::kParseDefaultFlags | rapidjson::kParseStreamFlag>(
-        json_stream,
-        configuration_constructor
-    );
+        const size_t index = frame.next_index++;
+        const size_t node = m_paths->index_child(frame.node, index);
 
-    if (!parse_success) {
-        size_t error_offset = std::max<size_t>(1, json_stream.Tell()) - 1;
+        mark = m_builder.Size();
 
-        if (json_reader.HasParseError()) {
-            throw json_parsing_error_t(error_offset, json_reader.GetParseError());
-        } else {
-            throw json_parsing_error_t(error_offset, "unknown error");
+        if (node != path_tree_t::no_node) {
+            for (size_t i = frame.size; i < index; ++i) {
+                m_builder.Null();
+            }
         }
+
+        return node;
     }
 
-    return configuration_constructor.Result();
-}
+    // Returns true if the scalar is selected and must be built.
+    bool
+    start_scalar() {
+        if (m_skipped > 0) {
+            return false;
+        } else if (m_selected > 0) {
+            return true;
+        }
 
-void
-kora::write_json(std::ostream &output, const dynamic_t& value) {
-    rapidjson_ostream_t rapidjson_stream = &output;
-    ostream_simple_writer_t writer = rapidjson_stream;
-    writer.SetFlags(rapidjson::kSerializeAnyValueFlag);
-    value.apply(to_stream_visitor<ostream_simple_writer_t>(&writer));
-}
+        size_t mark;
+        const size_t node = start_value(mark);
 
-void
-kora::write_pretty_json(std::ostream &output, const dynamic_t& value, size_t indent) {
-    rapidjson_ostream_t rapidjson_stream = &output;
-    ostream_pretty_writer_t writer = rapidjson_stream;
+        if (node != path_tree_t::no_node && m_paths->selected(node)) {
+            return true;
+        }
+
+        // Scalars don't contain anything to select.
+        m_builder.Truncate(mark);
+        return false;
+    }
+
+    void
+    start_container(bool object) {
+        if (m_skipped > 0) {
+            ++m_skipped;
+            return;
+        } else if (m_selected > 0) {
+            ++m_selected;
+            object ? m_builder.StartObject() : m_builder.StartArray();
+            return;
+        }
+
+        size_t mark;
+        const size_t node = start_value(mark);
+
+        if (node == path_tree_t::no_node) {
+            m_skipped = 1;
+        } else if (m_paths->selected(node)) {
+            m_selected = 1;
+            object ? m_builder.StartObject() : m_builder.StartArray();
+        } else {
+            frame_t frame;
+            frame.node = node;
+            frame.object = object;
+            frame.mark = mark;
+            frame.size = 0;
+            frame.next_index = 0;
+
+            m_frames.push_back(frame);
+        }
+    }
+
+    void
+    finish_container(bool object, size_t size) {
+        if (m_skipped > 0) {
+            --m_skipped;
+            return;
+        } else if (m_selected > 0) {
+            object ? m_builder.EndObject(size) : m_builder.EndArray(size);
+
+            if (--m_selected == 0) {
+                finish_value();
+            }
+
+            return;
+        }
+
+        const frame_t frame = m_frames.back();
+        m_frames.pop_back();
+
+        // The container doesn't lead to selected values.
+        if (frame.size == 0) {
+            m_builder.Truncate(frame.mark);
+            return;
+        }
+
+        object ? m_builder.EndObject(frame.size) : m_builder.EndArray(frame.size);
+        finish_value();
+    }
+
+    // Called when the value is left on the stack. Items of selected containers are counted by rapidjson.
+    void
+    finish_value() {
+        if (m_selected > 0 || m_frames.empty()) {
+            return;
+        }
+
+        frame_t& frame = m_frames.back();
+
+        if (frame.object) {
+            ++frame.size;
+        } else {
+            frame.size = frame.next_index;
+        }
+    }
+
+private:
+    const path_tree_t *m_paths;
+    json_to_dynamic_reader_t m_builder;
+    std::vector<frame_t> m_frames;
+
+    // Depth of the skipped or selected container being read.
+    size_t m_skipped;
+    size_t m_selected;
+
+    // Node and mark of the value of the last key.
+    size_t m_key_node;
+    size_t m_key_mark;
+};
+
+// Reads the input stream by blocks directly from its stream buffer
+// instead of calling std::istream::peek() and get() for each character.
+// The block grows with the amount of data available in the stream buffer, so small messages
+// don't allocate much memory.
+class istream_buffer_t {
+    typedef std::char_traits<char> traits_type;
+
+    static const size_t max_block_size = 64 * 1024;
+
+public:
+    // The storage for the blocks is provided by the caller to be reused between calls.
+    istream_buffer_t(std::istream& backend, std::vector<char>& storage) :
+        m_backend(backend),
+        m_storage(storage),
+        m_buffer(storage.data()),
+        m_current(m_buffer),
+        m_end(m_buffer),
+        m_consumed(0),
+        m_eof(false)
+    {
+
+        std::istream::sentry sentry(m_backend, true);
+
+        if (!sentry) {
+            m_eof = true;
+        }
+    }
+
+    char
+    peek() {
+        if (m_current == m_end && !fill()) {
+            return '\0';
+        }
+
+        return *m_current;
+    }
+
+    char
+    take() {
+        if (m_current == m_end && !fill()) {
+            return '\0';
+        }
+
+        return *m_current++;
+    }
+
+    size_t
+    tell() const {
+        return m_consumed + (m_current - m_buffer);
+    }
+
+    // Returns the characters read but not consumed by the parser back to the stream.
+    void
+    finish() {
+        while (m_end != m_current) {
+            --m_end;
+
+            if (traits_type::eq_int_type(m_backend.rdbuf()->sputbackc(*m_end), traits_type::eof())) {
+                m_backend.setstate(std::ios_base::badbit);
+                break;
+            }
+        }
+
+        if (m_eof) {
+            m_backend.setstate(std::ios_base::eofbit);
+        }
+    }
+
+private:
+    bool
+    fill() {
+        if (m_eof) {
+            return false;
+        }
+
+        m_consumed += m_end - m_buffer;
+        m_current = m_end = m_buffer;
+
+        std::streambuf *source = m_backend.rdbuf();
+
+        // Read only what is already buffered, so that unconsumed characters can be put back.
+        std::streamsize available = source->in_avail();
+
+        if (available <= 0) {
+            if (traits_type::eq_int_type(source->sgetc(), traits_type::eof())) {
+                m_eof = true;
+                return false;
+            }
+
+            available = std::max<std::streamsize>(1, source->in_avail());
+        }
+
+        const size_t wanted = std::min(static_cast<size_t>(available), static_cast<size_t>(max_block_size));
+
+        // Everything in the block is consumed, so it may be reallocated.
+        if (m_storage.size() < wanted) {
+            m_storage.resize(std::min(std::max(wanted, 2 * m_storage.size()), static_cast<size_t>(max_block_size)));
+            m_buffer = m_current = m_end = m_storage.data();
+        }
+
+        m_end += source->sgetn(m_buffer, std::min<std::streamsize>(available, m_storage.size()));
+
+        return m_current != m_end;
+    }
+
+private:
+    std::istream& m_backend;
+    std::vector<char>& m_storage;
+    char *m_buffer;
+    char *m_current;
+    char *m_end;
+    size_t m_consumed;
+    bool m_eof;
+};
+
+// rapidjson copies streams by value, so it's just a cheap handle to istream_buffer_t.
+struct rapidjson_istream_t {
+    rapidjson_istream_t(istream_buffer_t *backend) :
+        m_backend(backend)
+    { }
+
+    char
+    Peek() const {
+        return m_backend->peek();
+    }
+
+    char
+    Take() {
+        return m_backend->take();
+    }
+
+    size_t
+    Tell() const {
+        return m_backend->tell();
+    }
+
+    char*
+    PutBegin() {
+        assert(false);
+        return 0;
+    }
+
+    void
+    Put(char) {
+        assert(false);
+    }
+
+    size_t
+    PutEnd(char*) {
+        assert(false);
+        return 0;
+    }
+
+private:
+    istream_buffer_t *m_backend;
+};
+
+// Parses JSON directly from memory.
+struct rapidjson_memory_stream_t {
+    rapidjson_memory_stream_t(const char *data, size_t size) :
+        m_begin(data),
+        m_current(data),
+        m_end(data + size)
+    { }
+
+    char
+    Peek() const {
+        if (m_current == m_end) {
+            return '\0';
+        } else {
+            return *m_current;
+        }
+    }
+
+    char
+    Take() {
+        if (m_current == m_end) {
+            return '\0';
+        } else {
+            return *m_current++;
+        }
+    }
+
+    size_t
+    Tell() const {
+        return m_current - m_begin;
+    }
+
+    char*
+    PutBegin() {
+        assert(false);
+        return 0;
+    }
+
+    void
+    Put(char) {
+        assert(false);
+    }
+
+    size_t
+    PutEnd(char*) {
+        assert(false);
+        return 0;
+    }
+
+private:
+    const char *m_begin;
+    const char *m_current;
+    const char *m_end;
+};
+
+// Only lets rapidjson check the syntax.
+struct json_validator_t {
+    void
+    Null() { }
+
+    void
+    Bool(bool) { }
+
+    void
+    Int(int) { }
+
+    void
+    Uint(unsigned) { }
+
+    void
+    Int64(int64_t) { }
+
+    void
+    Uint64(uint64_t) { }
+
+    void
+    Double(double) { }
+
+    void
+    String(const char*, size_t, bool) { }
+
+    void
+    StartObject() { }
+
+    void
+    EndObject(size_t) { }
+
+    void
+    StartArray() { }
+
+    void
+    EndArray(size_t) { }
+};
+
+// Builds the top levels of the tree and keeps deeper arrays and objects as slices of the input.
+// rapidjson still checks the skipped containers, but no values are created for them.
+class json_lazy_reader_t {
+public:
+    json_lazy_reader_t() :
+        m_stream(nullptr)
+    { }
+
+    void
+    Reset(std::shared_ptr<const std::string> buffer, const rapidjson_memory_stream_t *stream, size_t depth) {
+        m_buffer = std::move(buffer);
+        m_stream = stream;
+        m_builder.Reset(nullptr);
+        m_depth = depth;
+        m_open = 0;
+        m_skipped = 0;
+    }
+
+    dynamic_t
+    Result() {
+        m_buffer.reset();
+        return m_builder.Result();
+    }
+
+    void
+    Null() {
+        if (m_skipped == 0) {
+            m_builder.Null();
+        }
+    }
+
+    void
+    Bool(bool v) {
+        if (m_skipped == 0) {
+            m_builder.Bool(v);
+        }
+    }
+
+    void
+    Int(int v) {
+        if (m_skipped == 0) {
+            m_builder.Int(v);
+        }
+    }
+
+    void
+    Uint(unsigned v) {
+        if (m_skipped == 0) {
+            m_builder.Uint(v);
+        }
+    }
+
+    void
+    Int64(int64_t v) {
+        if (m_skipped == 0) {
+            m_builder.Int64(v);
+        }
+    }
+
+    void
+    Uint64(uint64_t v) {
+        if (m_skipped == 0) {
+            m_builder.Uint64(v);
+        }
+    }
+
+    void
+    Double(double v) {
+        if (m_skipped == 0) {
+            m_builder.Double(v);
+        }
+    }
+
+    void
+    String(const char* data, size_t size, bool copy) {
+        if (m_skipped == 0) {
+            m_builder.String(data, size, copy);
+        }
+    }
+
+    void
+    StartObject() {
+        start_container();
+    }
+
+    void
+    EndObject(size_t size) {
+        if (finish_container()) {
+            m_builder.EndObject(size);
+        }
+    }
+
+    void
+    StartArray() {
+        start_container();
+    }
+
+    void
+    EndArray(size_t size) {
+        if (finish_container()) {
+            m_builder.EndArray(size);
+        }
+    }
+
+private:
+    // rapidjson reports the start of a container after taking its bracket.
+    void
+    start_container() {
+        if (m_skipped > 0 || m_open == m_depth) {
+            if (m_skipped++ == 0) {
+                m_start = m_stream->Tell() - 1;
+            }
+        } else {
+            ++m_open;
+        }
+    }
+
+    // Returns true if the container is built.
+    bool
+    finish_container() {
+        if (m_skipped == 0) {
+            --m_open;
+            return true;
+        }
+
+        if (--m_skipped == 0) {
+            const string_view_t text(m_buffer->data() + m_start, m_stream->Tell() - m_start);
+            m_builder.Value(json_reader_access_t::make_json_text(m_buffer, text));
+        }
+
+        return false;
+    }
+
+private:
+    std::shared_ptr<const std::string> m_buffer;
+    const rapidjson_memory_stream_t *m_stream;
+    json_to_dynamic_reader_t m_builder;
+
+    size_t m_depth;
+
+    // Number of the containers being built.
+    size_t m_open;
+
+    // Nesting level inside of the container being skipped, and the position of its bracket.
+    size_t m_skipped;
+    size_t m_start;
+};
+
+// Collects the output in blocks to avoid calling std::ostream for each character.
+class rapidjson_ostream_t {
+    static const size_t block_size = 4096;
+
+public:
+    rapidjson_ostream_t(std::ostream *backend) :
+        m_backend(backend),
+        m_size(0)
+    { }
+
+    char
+    Peek() const {
+        assert(false);
+        return 0;
+    }
+
+    char
+    Take() {
+        assert(false);
+        return 0;
+    }
+
+    size_t
+    Tell() const {
+        assert(false);
+        return 0;
+    }
+
+    char*
+    PutBegin() {
+        assert(false);
+        return 0;
+    }
+
+    void
+    Put(char c) {
+        if (m_size == block_size) {
+            Flush();
+        }
+
+        m_buffer[m_size++] = c;
+    }
+
+    // Large pieces are written directly to the stream.
+    void
+    Write(const char *data, size_t size) {
+        if (size > block_size - m_size) {
+            Flush();
+        }
+
+        if (size >= block_size) {
+            m_backend->write(data, size);
+        } else {
+            std::copy(data, data + size, m_buffer + m_size);
+            m_size += size;
+        }
+    }
+
+    size_t
+    PutEnd(char*) {
+        assert(false);
+        return 0;
+    }
+
+    void
+    Flush() {
+        m_backend->write(m_buffer, m_size);
+        m_size = 0;
+    }
+
+private:
+    std::ostream *m_backend;
+    size_t m_size;
+    char m_buffer[block_size];
+};
+
+// Appends the output directly to a string.
+struct rapidjson_string_stream_t {
+    rapidjson_string_stream_t(std::string *backend) :
+        m_backend(backend)
+    { }
+
+    char
+    Peek() const {
+        assert(false);
+        return 0;
+    }
+
+    char
+    Take() {
+        assert(false);
+        return 0;
+    }
+
+    size_t
+    Tell() const {
+        assert(false);
+        return 0;
+    }
+
+    char*
+    PutBegin() {
+        assert(false);
+        return 0;
+    }
+
+    void
+    Put(char c) {
+        m_backend->push_back(c);
+    }
+
+    void
+    Write(const char *data, size_t size) {
+        m_backend->append(data, size);
+    }
+
+    size_t
+    PutEnd(char*) {
+        assert(false);
+        return 0;
+    }
+
+    void
+    Flush() {
+        // Empty.
+    }
+
+private:
+    std::string *m_backend;
+};
+
+// Round-trip formatting of doubles by the Grisu2 algorithm of Florian Loitsch,
+// "Printing Floating-Point Numbers Quickly and Accurately with Integers".
+// The digits always read back as the same double. They are the shortest ones in most cases, but not always:
+// 1e23 is written as 9.999999999999999e22.
+namespace grisu {
+
+// Number f * 2^e with a 64-bit significand.
+struct diy_fp_t {
+    static const int significand_size = 52;
+    static const uint64_t hidden_bit = 1ULL << significand_size;
+
+    diy_fp_t(uint64_t f, int e) :
+        f(f),
+        e(e)
+    { }
+
+    explicit
+    diy_fp_t(double value) {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+
+        const int biased_exponent = static_cast<int>((bits >> significand_size) & 0x7ff);
+        const uint64_t significand = bits & (hidden_bit - 1);
+
+        if (biased_exponent != 0) {
+            f = significand + hidden_bit;
+            e = biased_exponent - 1075;
+        } else {
+            f = significand;
+            e = -1074;
+        }
+    }
+
+    diy_fp_t
+    operator-(const diy_fp_t& other) const {
+        return diy_fp_t(f - other.f, e);
+    }
+
+    // The product is rounded to the upper 64 bits.
+    diy_fp_t
+    operator*(const diy_fp_t& other) const {
+        const uint64_t mask = 0xffffffffULL;
+
+        const uint64_t a = f >> 32;
+        const uint64_t b = f & mask;
+        const uint64_t c = other.f >> 32;
+        const uint64_t d = other.f & mask;
+
+        const uint64_t ac = a * c;
+        const uint64_t bc = b * c;
+        const uint64_t ad = a * d;
+        const uint64_t bd = b * d;
+
+        const uint64_t middle = (bd >> 32) + (ad & mask) + (bc & mask) + (1ULL << 31);
+
+        return diy_fp_t(ac + (ad >> 32) + (bc >> 32) + (middle >> 32), e + other.e + 64);
+    }
+
+    diy_fp_t
+    normalize() const {
+        diy_fp_t result = *this;
+
+        while (!(result.f & (1ULL << 63))) {
+            result.f <<= 1;
+            result.e--;
+        }
+
+        return result;
+    }
+
+    // Boundaries of the interval of the numbers rounding to this one, normalized to the exponent of the upper one.
+    void
+    normalized_boundaries(diy_fp_t& minus, diy_fp_t& plus) const {
+        plus = diy_fp_t((f << 1) + 1, e - 1).normalize();
+
+        // The lower boundary is closer if the significand is a power of two.
+        minus = f == hidden_bit ? diy_fp_t((f << 2) - 1, e - 2) : diy_fp_t((f << 1) - 1, e - 1);
+        minus.f <<= minus.e - plus.e;
+        minus.e = plus.e;
+    }
+
+    uint64_t f;
+    int e;
+};
+
+// Normalized 10^k for k = -348, -340, ..., 340.
+const uint64_t cached_powers_f[] = {
+    0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL,
+    0xcf42894a5dce35eaULL, 0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL,
+    0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL, 0xbe5691ef416bd60cULL,
+    0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+    0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL,
+    0xc21094364dfb5637ULL, 0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL,
+    0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL, 0xb23867fb2a35b28eULL,
+    0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+    0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL,
+    0xb5b5ada8aaff80b8ULL, 0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL,
+    0x964e858c91ba2655ULL, 0xdff9772470297ebdULL, 0xa6dfbd9fb8e5b88fULL,
+    0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+    0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL,
+    0xaa242499697392d3ULL, 0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL,
+    0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL, 0x9c40000000000000ULL,
+    0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+    0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL,
+    0x9f4f2726179a2245ULL, 0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL,
+    0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL, 0x924d692ca61be758ULL,
+    0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+    0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL,
+    0x952ab45cfa97a0b3ULL, 0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL,
+    0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL, 0x88fcf317f22241e2ULL,
+    0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+    0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL,
+    0x8bab8eefb6409c1aULL, 0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL,
+    0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL, 0x80444b5e7aa7cf85ULL,
+    0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+    0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL
+};
+
+const int16_t cached_powers_e[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+    -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+    -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+    -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+    -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+    109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+    641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+    907, 933, 960, 986, 1013, 1039, 1066
+};
+
+const uint64_t powers_of_ten[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+    1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+    100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+    1000000000000000000ULL, 10000000000000000000ULL
+};
+
+// Returns 10^-k such that multiplying a number with the binary exponent e by it gives
+// the exponent between -60 and -32.
+diy_fp_t
+cached_power(int e, int& k) {
+    const double dk = (-61 - e) * 0.30102999566398114 + 347;
+
+    int rounded = static_cast<int>(dk);
+
+    if (dk - rounded > 0.0) {
+        ++rounded;
+    }
+
+    const size_t index = static_cast<size_t>((rounded >> 3) + 1);
+    k = -(-348 + static_cast<int>(index << 3));
+
+    return diy_fp_t(cached_powers_f[index], cached_powers_e[index]);
+}
+
+int
+count_digits(uint32_t n) {
+    int result = 1;
+
+    while (n >= 10 && result < 10) {
+        n /= 10;
+        ++result;
+    }
+
+    return result;
+}
+
+// Moves the last digit closer to the exact value while the result stays in the interval.
+void
+round_weed(char *buffer, int length, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t distance) {
+    while (rest < distance && delta - rest >= ten_kappa &&
+           (rest + ten_kappa < distance || distance - rest > rest + ten_kappa - distance))
+    {
+        buffer[length - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+// Generates the shortest digits of a number in the interval (high - delta, high]. The interval is narrowed
+// to be safe from the errors of the cached powers, so the digits aren't always the shortest ones of the double.
+void
+generate_digits(const diy_fp_t& value, const diy_fp_t& high, uint64_t delta, char *buffer, int& length, int& k) {
+    const diy_fp_t one(1ULL << -high.e, high.e);
+    const uint64_t distance = (high - value).f;
+
+    uint32_t integral = static_cast<uint32_t>(high.f >> -one.e);
+    uint64_t fractional = high.f & (one.f - 1);
+
+    int kappa = count_digits(integral);
+    length = 0;
+
+    while (kappa > 0) {
+        const uint32_t divisor = static_cast<uint32_t>(powers_of_ten[kappa - 1]);
+        const uint32_t digit = integral / divisor;
+        integral %= divisor;
+
+        if (digit || length) {
+            buffer[length++] = static_cast<char>('0' + digit);
+        }
+
+        --kappa;
+
+        const uint64_t rest = (static_cast<uint64_t>(integral) << -one.e) + fractional;
+
+        if (rest <= delta) {
+            k += kappa;
+            round_weed(buffer, length, delta, rest, powers_of_ten[kappa] << -one.e, distance);
+            return;
+        }
+    }
+
+    while (true) {
+        fractional *= 10;
+        delta *= 10;
+
+        const char digit = static_cast<char>(fractional >> -one.e);
+
+        if (digit || length) {
+            buffer[length++] = static_cast<char>('0' + digit);
+        }
+
+        fractional &= one.f - 1;
+        --kappa;
+
+        if (fractional < delta) {
+            k += kappa;
+            round_weed(buffer, length, delta, fractional, one.f, -kappa < 20 ? distance * powers_of_ten[-kappa] : 0);
+            return;
+        }
+    }
+}
+
+// Writes the digits of a positive finite number, which is equal to digits * 10^k.
+void
+grisu2(double value, char *buffer, int& length, int& k) {
+    const diy_fp_t v(value);
+
+    diy_fp_t minus(0, 0);
+    diy_fp_t plus(0, 0);
+    v.normalized_boundaries(minus, plus);
+
+    const diy_fp_t power = cached_power(plus.e, k);
+    const diy_fp_t scaled = v.normalize() * power;
+
+    // The interval is narrowed to be inside the exact one despite the rounding errors.
+    diy_fp_t scaled_plus = plus * power;
+    diy_fp_t scaled_minus = minus * power;
+    scaled_minus.f++;
+    scaled_plus.f--;
+
+    generate_digits(scaled, scaled_plus, scaled_plus.f - scaled_minus.f, buffer, length, k);
+}
+
+char*
+write_exponent(int k, char *buffer) {
+    if (k < 0) {
+        *buffer++ = '-';
+        k = -k;
+    }
+
+    if (k >= 100) {
+        *buffer++ = static_cast<char>('0' + k / 100);
+        k %= 100;
+        *buffer++ = static_cast<char>('0' + k / 10);
+    } else if (k >= 10) {
+        *buffer++ = static_cast<char>('0' + k / 10);
+    }
+
+    *buffer++ = static_cast<char>('0' + k % 10);
+
+    return buffer;
+}
+
+// Places the decimal point or adds the exponent. Numbers without a fraction get ".0",
+// so they are read back as doubles.
+char*
+prettify(char *buffer, int length, int k) {
+    // 10^(point - 1) <= value < 10^point
+    const int point = length + k;
+
+    if (k >= 0 && point <= 21) {
+        // 1234e3 -> 1234000.0
+        std::fill(buffer + length, buffer + point, '0');
+        buffer[point] = '.';
+        buffer[point + 1] = '0';
+        return buffer + point + 2;
+    } else if (point > 0 && point <= 21) {
+        // 1234e-2 -> 12.34
+        std::memmove(buffer + point + 1, buffer + point, length - point);
+        buffer[point] = '.';
+        return buffer + length + 1;
+    } else if (point > -6 && point <= 0) {
+        // 1234e-6 -> 0.001234
+        const int offset = 2 - point;
+        std::memmove(buffer + offset, buffer, length);
+        buffer[0] = '0';
+        buffer[1] = '.';
+        std::fill(buffer + 2, buffer + offset, '0');
+        return buffer + length + offset;
+    } else if (length == 1) {
+        // 1e30
+        buffer[1] = 'e';
+        return write_exponent(point - 1, buffer + 2);
+    } else {
+        // 1234e30 -> 1.234e33
+        std::memmove(buffer + 2, buffer + 1, length - 1);
+        buffer[1] = '.';
+        buffer[length + 1] = 'e';
+        return write_exponent(point - 1, buffer + length + 2);
+    }
+}
+
+} // namespace grisu
+
+// Writes a JSON number which is read back as the same finite double: round-trip, shortest in most cases.
+// The buffer must have room for 25 characters. Returns the end of the number.
+char*
+format_double(double value, char *buffer) {
+    if (std::signbit(value)) {
+        *buffer++ = '-';
+        value = -value;
+    }
+
+    if (value == 0) {
+        std::memcpy(buffer, "0.0", 3);
+        return buffer + 3;
+    }
+
+    int length;
+    int k;
+    grisu::grisu2(value, buffer, length, k);
+
+    return grisu::prettify(buffer, length, k);
+}
+
+// Writers which also write raw pieces of JSON: numbers formatted by format_double() and JSON text.
+// The prefix of the writer puts the separators and indentation before the piece as before any value.
+template<class Stream>
+class simple_writer_t:
+    public rapidjson::Writer<Stream>
+{
+public:
+    explicit
+    simple_writer_t(Stream& stream) :
+        rapidjson::Writer<Stream>(stream)
+    { }
+
+    void
+    RawValue(const char *data, size_t size, rapidjson::Type type) {
+        this->Prefix(type);
+        this->stream_.Write(data, size);
+    }
+};
+
+template<class Stream>
+class pretty_writer_t:
+    public rapidjson::PrettyWriter<Stream>
+{
+public:
+    explicit
+    pretty_writer_t(Stream& stream) :
+        rapidjson::PrettyWriter<Stream>(stream)
+    { }
+
+    void
+    RawValue(const char *data, size_t size, rapidjson::Type type) {
+        this->PrettyPrefix(type);
+        this->stream_.Write(data, size);
+    }
+};
+
+// Doubles are formatted by format_double() and written as raw values.
+// If keep_text is set, JSON text of values is written as is. Otherwise it's parsed and formatted.
+template<class Writer>
+struct to_stream_visitor:
+    public boost::static_visitor<>
+{
+    to_stream_visitor(Writer *writer, bool keep_text) :
+        m_writer(writer),
+        m_keep_text(keep_text)
+    { }
+
+    void
+    operator()(const dynamic_t::null_t&) const {
+        m_writer->Null();
+    }
+
+    void
+    operator()(const dynamic_t::bool_t& v) const {
+        m_writer->Bool(v);
+    }
+
+    void
+    operator()(const dynamic_t::int_t& v) const {
+        m_writer->Int64(v);
+    }
+
+    void
+    operator()(const dynamic_t::uint_t& v) const {
+        m_writer->Uint64(v);
+    }
+
+    // Infinities and NaN aren't valid JSON, so the writer handles them as it can.
+    void
+    operator()(const dynamic_t::double_t& v) const {
+        if (std::isfinite(v)) {
+            char buffer[32];
+            const char *end = format_double(v, buffer);
+
+            m_writer->RawValue(buffer, end - buffer, rapidjson::kNumberType);
+        } else {
+            m_writer->Double(v);
+        }
+    }
+
+    void
+    operator()(const dynamic_t::string_t& v) const {
+        m_writer->String(v.data(), v.size());
+    }
+
+    void
+    operator()(const dynamic_t::array_t& v) const {
+        m_writer->StartArray();
+
+        for (auto it = v.begin(); it != v.end(); ++it) {
+            write(*it);
+        }
+
+        m_writer->EndArray();
+    }
+
+    void
+    operator()(const dynamic_t::object_t& v) const {
+        m_writer->StartObject();
+
+        for (auto it = v.begin(); it != v.end(); ++it) {
+            m_writer->String(it->first.data(), it->first.size());
+            write(it->second);
+        }
+
+        m_writer->EndObject();
+    }
+
+    // Writes strings directly from the stored characters instead of copying them to string_t.
+    void
+    write(const dynamic_t& value) const {
+        if (value.is_string()) {
+            const string_view_t string = value.as_string_view();
+            m_writer->String(string.data(), string.size());
+        } else if (m_keep_text && !value.json_text().empty()) {
+            const string_view_t text = value.json_text();
+            const rapidjson::Type type = value.is_array() ? rapidjson::kArrayType : rapidjson::kObjectType;
+            m_writer->RawValue(text.data(), text.size(), type);
+        } else {
+            value.apply(*this);
+        }
+    }
+
+private:
+    Writer *m_writer;
+    bool m_keep_text;
+};
+
+template<class Stream>
+void
+write_simple(Stream& stream, const dynamic_t& value) {
+    typedef simple_writer_t<Stream> writer_type;
+
+    writer_type writer(stream);
+    writer.SetFlags(rapidjson::kSerializeAnyValueFlag);
+    to_stream_visitor<writer_type>(&writer, true).write(value);
+    stream.Flush();
+}
+
+template<class Stream>
+void
+write_pretty(Stream& stream, const dynamic_t& value, size_t indent) {
+    typedef pretty_writer_t<Stream> writer_type;
+
+    writer_type writer(stream);
     writer.SetFlags(rapidjson::kSerializeAnyValueFlag);
     writer.SetIndent(' ', indent);
-    value.apply(to_stream_visitor<ostream_pretty_writer_t>(&writer));
+    to_stream_visitor<writer_type>(&writer, false).write(value);
+    stream.Flush();
+}
+
+} // namespace
+
+namespace {
+
+KORA_NORETURN
+void
+throw_parsing_error(const rapidjson::Reader& json_reader, size_t stream_offset) {
+    size_t error_offset = std::max<size_t>(1, stream_offset) - 1;
+
+    if (json_reader.HasParseError()) {
+        throw json_parsing_error_t(error_offset, json_reader.GetParseError());
+    } else {
+        throw json_parsing_error_t(error_offset, "unknown error");
+    }
+}
+
+} // namespace
+
+namespace {
+
+// Keeps the memory used by the parser between calls.
+class parsing_context_t {
+    static const unsigned parse_flags = rapidjson::kParseDefaultFlags | rapidjson::kParseStreamFlag;
+
+public:
+    parsing_context_t() :
+        m_reader(&m_allocator)
+    { }
+
+    dynamic_t
+    read(std::istream &input, document_t *document = nullptr) {
+        m_constructor.Reset(document);
+        parse(input, m_constructor);
+        return m_constructor.Result();
+    }
+
+    dynamic_t
+    read(const char *data, size_t size, size_t *consumed, document_t *document = nullptr) {
+        m_constructor.Reset(document);
+        parse(data, size, consumed, m_constructor);
+        return m_constructor.Result();
+    }
+
+    void
+    read(std::istream &input, json_handler_t &handler) {
+        m_events.Reset(&handler);
+        parse(input, m_events);
+    }
+
+    void
+    read(const char *data, size_t size, size_t *consumed, json_handler_t &handler) {
+        m_events.Reset(&handler);
+        parse(data, size, consumed, m_events);
+    }
+
+    dynamic_t
+    read(std::istream &input, const path_tree_t &paths) {
+        m_projection.Reset(&paths);
+        read(input, m_projection);
+        return m_projection.Result();
+    }
+
+    dynamic_t
+    read(const char *data, size_t size, size_t *consumed, const path_tree_t &paths) {
+        m_projection.Reset(&paths);
+        read(data, size, consumed, m_projection);
+        return m_projection.Result();
+    }
+
+    dynamic_t
+    read(const std::shared_ptr<const std::string> &buffer, size_t depth, size_t *consumed) {
+        rapidjson_memory_stream_t json_stream(buffer->data(), buffer->size());
+
+        m_lazy.Reset(buffer, &json_stream, depth);
+        parse(json_stream, consumed, m_lazy);
+        return m_lazy.Result();
+    }
+
+private:
+    template<class Handler>
+    void
+    parse(std::istream &input, Handler &handler) {
+        istream_buffer_t input_buffer(input, m_input_buffer);
+        rapidjson_istream_t json_stream(&input_buffer);
+
+        bool parse_success;
+
+        // A json_handler_t may throw to stop the reading.
+        try {
+            parse_success = m_reader.Parse<parse_flags>(json_stream, handler);
+        } catch (...) {
+            input_buffer.finish();
+            throw;
+        }
+
+        input_buffer.finish();
+
+        if (!parse_success) {
+            throw_parsing_error(m_reader, json_stream.Tell());
+        }
+    }
+
+    template<class Handler>
+    void
+    parse(const char *data, size_t size, size_t *consumed, Handler &handler) {
+        rapidjson_memory_stream_t json_stream(data, size);
+        parse(json_stream, consumed, handler);
+    }
+
+    template<class Handler>
+    void
+    parse(rapidjson_memory_stream_t &json_stream, size_t *consumed, Handler &handler) {
+        bool parse_success = m_reader.Parse<parse_flags>(json_stream, handler);
+
+        if (!parse_success) {
+            throw_parsing_error(m_reader, json_stream.Tell());
+        }
+
+        if (consumed) {
+            *consumed = json_stream.Tell();
+        }
+    }
+
+private:
+    rapidjson::MemoryPoolAllocator<> m_allocator;
+    rapidjson::Reader m_reader;
+    json_to_dynamic_reader_t m_constructor;
+    json_event_reader_t m_events;
+    json_projection_reader_t m_projection;
+    json_lazy_reader_t m_lazy;
+    std::vector<char> m_input_buffer;
+};
+
+} // namespace
+
+namespace {
+
+bool
+is_json_space(char c) KORA_NOEXCEPT {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+} // namespace
+
+dynamic_t
+dynamic_t::from_json_text(std::shared_ptr<const std::string> buffer, const string_view_t& text) {
+    const char *begin = text.begin();
+    const char *end = text.end();
+
+    while (begin != end && is_json_space(*begin)) {
+        ++begin;
+    }
+
+    while (begin != end && is_json_space(*(end - 1))) {
+        --end;
+    }
+
+    const size_t offset = begin - text.begin();
+    const size_t size = end - begin;
+
+    if (begin == end || (*begin != '[' && *begin != '{')) {
+        throw json_parsing_error_t(offset, "JSON text must be an array or an object");
+    }
+
+    // The text is checked without building anything, it's parsed when it's accessed.
+    rapidjson::MemoryPoolAllocator<> allocator;
+    rapidjson::Reader reader(&allocator);
+    rapidjson_memory_stream_t json_stream(begin, size);
+    json_validator_t validator;
+
+    if (!reader.Parse<rapidjson::kParseDefaultFlags | rapidjson::kParseStreamFlag>(json_stream, validator)) {
+        throw_parsing_error(reader, offset + json_stream.Tell());
+    }
+
+    if (json_stream.Tell() != size) {
+        throw json_parsing_error_t(offset + json_stream.Tell(), "Nothing should follow the root object or array.");
+    }
+
+    return make_json_text(std::move(buffer), string_view_t(begin, size));
+}
+
+dynamic_t
+kora::dynamic::read_json(std::istream &input) {
+    return parsing_context_t().read(input);
+}
+
+dynamic_t
+kora::dynamic::read_json(const char *data, size_t size, size_t *consumed) {
+    return parsing_context_t().read(data, size, consumed);
+}
+
+json_handler_t::~json_handler_t() KORA_NOEXCEPT { }
+
+void
+json_handler_t::null() { }
+
+void
+json_handler_t::boolean(dynamic_t::bool_t) { }
+
+void
+json_handler_t::integer(dynamic_t::int_t) { }
+
+void
+json_handler_t::unsigned_integer(dynamic_t::uint_t) { }
+
+void
+json_handler_t::floating_point(dynamic_t::double_t) { }
+
+void
+json_handler_t::string(const string_view_t&) { }
+
+void
+json_handler_t::key(const string_view_t&) { }
+
+void
+json_handler_t::start_array() { }
+
+void
+json_handler_t::finish_array(size_t) { }
+
+void
+json_handler_t::start_object() { }
+
+void
+json_handler_t::finish_object(size_t) { }
+
+class json_projection_t::implementation_t :
+    public path_tree_t
+{ };
+
+json_projection_t::json_projection_t(const std::vector<std::string>& paths) :
+    m_impl(new json_projection_t::implementation_t)
+{
+    for (auto it = paths.begin(); it != paths.end(); ++it) {
+        m_impl->add(*it);
+    }
+
+    m_impl->finish();
+}
+
+json_projection_t::~json_projection_t() KORA_NOEXCEPT { }
+
+class json_parser_t::implementation_t :
+    public parsing_context_t
+{ };
+
+json_parser_t::json_parser_t() :
+    m_impl(new json_parser_t::implementation_t)
+{ }
+
+json_parser_t::~json_parser_t() KORA_NOEXCEPT { }
+
+dynamic_t
+json_parser_t::parse(std::istream &input) {
+    return m_impl->read(input);
+}
+
+dynamic_t
+json_parser_t::parse(const char *data, size_t size, size_t *consumed) {
+    return m_impl->read(data, size, consumed);
+}
+
+dynamic_t
+json_parser_t::parse(const std::string &input, size_t *consumed) {
+    return m_impl->read(input.data(), input.size(), consumed);
+}
+
+dynamic_t
+json_parser_t::parse(std::istream &input, const json_projection_t &projection) {
+    return m_impl->read(input, *projection.m_impl);
+}
+
+dynamic_t
+json_parser_t::parse(const char *data, size_t size, const json_projection_t &projection, size_t *consumed) {
+    return m_impl->read(data, size, consumed, *projection.m_impl);
+}
+
+void
+json_parser_t::parse(std::istream &input, json_handler_t &handler) {
+    m_impl->read(input, handler);
+}
+
+void
+json_parser_t::parse(const char *data, size_t size, json_handler_t &handler, size_t *consumed) {
+    m_impl->read(data, size, consumed, handler);
+}
+
+dynamic_t
+kora::dynamic::read_json(const std::string &input, size_t *consumed) {
+    return read_json(input.data(), input.size(), consumed);
+}
+
+dynamic_t&
+kora::dynamic::read_json(std::istream &input, document_t &document) {
+    document.root() = parsing_context_t().read(input, &document);
+    return document.root();
+}
+
+dynamic_t&
+kora::dynamic::read_json(const char *data, size_t size, document_t &document, size_t *consumed) {
+    document.root() = parsing_context_t().read(data, size, consumed, &document);
+    return document.root();
+}
+
+dynamic_t
+kora::dynamic::read_json(std::istream &input, const json_projection_t &projection) {
+    return parsing_context_t().read(input, *projection.m_impl);
+}
+
+dynamic_t
+kora::dynamic::read_json(const char *data, size_t size, const json_projection_t &projection, size_t *consumed) {
+    return parsing_context_t().read(data, size, consumed, *projection.m_impl);
+}
+
+void
+kora::dynamic::read_json(std::istream &input, json_handler_t &handler) {
+    parsing_context_t().read(input, handler);
+}
+
+void
+kora::dynamic::read_json(const char *data, size_t size, json_handler_t &handler, size_t *consumed) {
+    parsing_context_t().read(data, size, consumed, handler);
+}
+
+dynamic_t
+kora::dynamic::read_lazy_json(const char *data, size_t size, size_t depth, size_t *consumed) {
+    return read_lazy_json(std::string(data, size), depth, consumed);
+}
+
+dynamic_t
+kora::dynamic::read_lazy_json(std::string input, size_t depth, size_t *consumed) {
+    const std::shared_ptr<const std::string> buffer = std::make_shared<const std::string>(std::move(input));
+    return parsing_context_t().read(buffer, depth, consumed);
+}
+
+void
+kora::write_json(std::ostream &output, const dynamic_t& value) {
+    rapidjson_ostream_t rapidjson_stream = &output;
+    write_simple(rapidjson_stream, value);
+}
+
+void
+kora::write_pretty_json(std::ostream &output, const dynamic_t& value, size_t indent) {
+    rapidjson_ostream_t rapidjson_stream = &output;
+    write_pretty(rapidjson_stream, value, indent);
 }
 
 std::string
 kora::to_json(const dynamic_t& value) {
-    std::ostringstream output;
-    write_json(output, value);
-    return output.str();
+    std::string result;
+    rapidjson_string_stream_t rapidjson_stream = &result;
+    write_simple(rapidjson_stream, value);
+
+    return result;
 }
 
 std::string
 kora::to_pretty_json(const dynamic_t& value, size_t indent) {
-    std::ostringstream output;
-    write_pretty_json(output, value, indent);
-    return output.str();
+    std::string result;
+    rapidjson_string_stream_t rapidjson_stream = &result;
+    write_pretty(rapidjson_stream, value, indent);
+
+    return result;
 }
 
 namespace {
@@ -365,6 +2223,17 @@ struct print_vistor_t:
         m_stream << v;
     }
 
+    // Doubles are printed like in JSON, so they are read back exactly.
+    void
+    operator()(const dynamic_t::double_t& v) const {
+        if (std::isfinite(v)) {
+            char buffer[32];
+            m_stream.write(buffer, format_double(v, buffer) - buffer);
+        } else {
+            m_stream << v;
+        }
+    }
+
 private:
     std::ostream& m_stream;
 };
@@ -375,6 +2244,8 @@ std::ostream&
 kora::operator<<(std::ostream& stream, const dynamic_t& value) {
     if (value.is_null() || value.is_array() || value.is_object()) {
         write_json(stream, value);
+    } else if (value.is_string()) {
+        stream << value.as_string_view();
     } else {
         value.apply(print_vistor_t(stream));
     }
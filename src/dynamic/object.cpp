@@ -20,8 +20,287 @@
 
 #include "kora/dynamic/dynamic.hpp"
 
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
 using namespace kora;
 
+namespace {
+
+// The comparators take the stored items, whose type is private.
+
+struct key_less_t {
+    template<class Item>
+    bool
+    operator()(const Item& item, const std::string& key) const {
+        return item.first < key;
+    }
+
+    template<class Item>
+    bool
+    operator()(const Item& left, const Item& right) const {
+        return left.first < right.first;
+    }
+};
+
+struct key_equal_t {
+    template<class Item>
+    bool
+    operator()(const Item& left, const Item& right) const {
+        return left.first == right.first;
+    }
+};
+
+// Orders positions of the items by key. Equal keys are ordered by position to keep the first one.
+template<class Items>
+struct position_less_t {
+    explicit
+    position_less_t(const Items& items) :
+        items(items)
+    { }
+
+    bool
+    operator()(size_t left, size_t right) const {
+        const int comparison = items[left].first.compare(items[right].first);
+        return comparison < 0 || (comparison == 0 && left < right);
+    }
+
+    const Items& items;
+};
+
+// Binary search which stops as soon as it meets the key.
+template<class Iterator>
+Iterator
+search(Iterator first, Iterator last, const std::string& key) {
+    const Iterator end = last;
+
+    while (first != last) {
+        const Iterator middle = first + (last - first) / 2;
+        const int comparison = middle->first.compare(key);
+
+        if (comparison == 0) {
+            return middle;
+        } else if (comparison < 0) {
+            first = middle + 1;
+        } else {
+            last = middle;
+        }
+    }
+
+    return end;
+}
+
+size_t
+hash_key(const std::string& key) {
+    return std::hash<std::string>()(key);
+}
+
+// Compares the items one by one if both sequences are sorted by key, or looks each key up otherwise.
+template<class Map>
+bool
+equal_to_map(const dynamic_t::object_t& object, const Map& map, bool sorted) {
+    if (object.size() != map.size()) {
+        return false;
+    }
+
+    if (!sorted) {
+        for (auto it = map.begin(); it != map.end(); ++it) {
+            auto object_it = object.find(it->first);
+
+            if (object_it == object.end() || object_it->second != it->second) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    auto map_it = map.begin();
+
+    for (auto it = object.begin(); it != object.end(); ++it, ++map_it) {
+        if (it->first != map_it->first || it->second != map_it->second) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} // namespace
+
+const dynamic_t::object_t::size_type dynamic_t::object_t::hash_threshold;
+const size_t dynamic_t::object_t::empty_slot;
+
+dynamic_t::object_t::object_t(const std::map<std::string, dynamic_t>& other) :
+    m_items(other.begin(), other.end())
+{
+    normalize();
+}
+
+dynamic_t::object_t::object_t(std::map<std::string, dynamic_t>&& other) {
+    m_items.reserve(other.size());
+
+    for (auto it = other.begin(); it != other.end(); ++it) {
+        m_items.push_back(item_type(it->first, std::move(it->second)));
+    }
+
+    other.clear();
+    normalize();
+}
+
+dynamic_t::object_t::iterator
+dynamic_t::object_t::find(const std::string& key) {
+    if (hashed()) {
+        const size_t position = find_hashed(key, hash_key(key));
+        return position == empty_slot ? end() : begin() + position;
+    }
+
+    return iterator(search(m_items.begin(), m_items.end(), key));
+}
+
+dynamic_t::object_t::const_iterator
+dynamic_t::object_t::find(const std::string& key) const {
+    if (hashed()) {
+        const size_t position = find_hashed(key, hash_key(key));
+        return position == empty_slot ? end() : begin() + position;
+    }
+
+    return const_iterator(search(m_items.begin(), m_items.end(), key));
+}
+
+dynamic_t::object_t::size_type
+dynamic_t::object_t::count(const std::string& key) const {
+    return find(key) == end() ? 0 : 1;
+}
+
+std::pair<dynamic_t::object_t::iterator, bool>
+dynamic_t::object_t::insert(const value_type& value) {
+    return insert_item(item_type(value.first, value.second));
+}
+
+std::pair<dynamic_t::object_t::iterator, bool>
+dynamic_t::object_t::insert(value_type&& value) {
+    // The key is constant, so it's copied.
+    return insert_item(item_type(value.first, std::move(value.second)));
+}
+
+std::pair<dynamic_t::object_t::iterator, bool>
+dynamic_t::object_t::insert_item(item_type&& value) {
+    if (hashed()) {
+        const size_t hash = hash_key(value.first);
+        const size_t position = find_hashed(value.first, hash);
+
+        if (position != empty_slot) {
+            return std::make_pair(begin() + position, false);
+        }
+
+        reserve_index(m_items.size() + 1);
+        append_hashed(std::move(value), hash);
+
+        return std::make_pair(end() - 1, true);
+    }
+
+    size_t position;
+
+    if (m_items.empty() || m_items.back().first < value.first) {
+        m_items.push_back(std::move(value));
+        position = m_items.size() - 1;
+    } else {
+        auto it = std::lower_bound(m_items.begin(), m_items.end(), value.first, key_less_t());
+
+        if (it != m_items.end() && it->first == value.first) {
+            return std::make_pair(iterator(it), false);
+        }
+
+        position = it - m_items.begin();
+        m_items.insert(it, std::move(value));
+    }
+
+    if (m_items.size() >= hash_threshold) {
+        normalize();
+    }
+
+    return std::make_pair(begin() + position, true);
+}
+
+dynamic_t::object_t::iterator
+dynamic_t::object_t::insert(const_iterator, const value_type& value) {
+    // Appending is already the fast path of the regular insert.
+    return insert(value).first;
+}
+
+dynamic_t::object_t::iterator
+dynamic_t::object_t::insert(const_iterator, value_type&& value) {
+    return insert(std::move(value)).first;
+}
+
+dynamic_t::object_t::iterator
+dynamic_t::object_t::erase(const_iterator position) {
+    return erase(position, position + 1);
+}
+
+dynamic_t::object_t::iterator
+dynamic_t::object_t::erase(const_iterator first, const_iterator last) {
+    const size_t first_position = first - cbegin();
+    const size_t last_position = last - cbegin();
+
+    if (!hashed()) {
+        return iterator(m_items.erase(m_items.begin() + first_position, m_items.begin() + last_position));
+    }
+
+    remove_slots(first_position, last_position);
+
+    // The last items fill the gap, so only their slots are updated instead of every following one.
+    const size_t size = m_items.size() - (last_position - first_position);
+    size_t position = first_position;
+
+    for (size_t i = std::max(last_position, size); i < m_items.size(); ++i, ++position) {
+        move_slot(i, position);
+        m_items[position] = std::move(m_items[i]);
+        m_hashes[position] = m_hashes[i];
+    }
+
+    m_items.erase(m_items.begin() + size, m_items.end());
+    m_hashes.resize(size);
+
+    return begin() + first_position;
+}
+
+dynamic_t::object_t::size_type
+dynamic_t::object_t::erase(const std::string& key) {
+    auto it = find(key);
+
+    if (it == end()) {
+        return 0;
+    }
+
+    erase(it);
+    return 1;
+}
+
+dynamic_t&
+dynamic_t::object_t::at(const std::string& key) {
+    auto it = find(key);
+
+    if (it == end()) {
+        throw std::out_of_range("object_t::at");
+    } else {
+        return it->second;
+    }
+}
+
+const dynamic_t&
+dynamic_t::object_t::at(const std::string& key) const {
+    auto it = find(key);
+
+    if (it == end()) {
+        throw std::out_of_range("object_t::at");
+    } else {
+        return it->second;
+    }
+}
+
 dynamic_t&
 dynamic_t::object_t::at(const std::string& key, dynamic_t& default_) {
     auto it = find(key);
@@ -59,3 +338,229 @@ const dynamic_t&
 dynamic_t::object_t::operator[](const std::string& key) const {
     return at(key);
 }
+
+dynamic_t&
+dynamic_t::object_t::operator[](const std::string& key) {
+    if (hashed()) {
+        const size_t hash = hash_key(key);
+        const size_t position = find_hashed(key, hash);
+
+        if (position != empty_slot) {
+            return m_items[position].second;
+        }
+
+        reserve_index(m_items.size() + 1);
+        append_hashed(item_type(key, dynamic_t()), hash);
+
+        return m_items.back().second;
+    }
+
+    auto it = std::lower_bound(m_items.begin(), m_items.end(), key, key_less_t());
+
+    if (it == m_items.end() || it->first != key) {
+        it = m_items.insert(it, item_type(key, dynamic_t()));
+
+        if (m_items.size() >= hash_threshold) {
+            const size_t position = it - m_items.begin();
+            normalize();
+            return m_items[position].second;
+        }
+    }
+
+    return it->second;
+}
+
+void
+dynamic_t::object_t::normalize() {
+    if (m_items.size() >= hash_threshold) {
+        // Build the hash table dropping the repeated keys, the order of the items is kept.
+        m_index.clear();
+        reserve_index(m_items.size());
+
+        m_hashes.clear();
+        m_hashes.reserve(m_items.size());
+
+        size_t size = 0;
+
+        for (size_t i = 0; i < m_items.size(); ++i) {
+            const size_t hash = hash_key(m_items[i].first);
+
+            if (find_hashed(m_items[i].first, hash) == empty_slot) {
+                if (size != i) {
+                    m_items[size] = std::move(m_items[i]);
+                }
+
+                m_hashes.push_back(hash);
+                add_slot(hash, size);
+                ++size;
+            }
+        }
+
+        m_items.erase(m_items.begin() + size, m_items.end());
+    } else if (std::is_sorted(m_items.begin(), m_items.end(), key_less_t())) {
+        // Already sorted, e.g. the items are taken from a std::map.
+    } else {
+        // Moving strings around is much more expensive than sorting indices.
+        std::vector<size_t> order(m_items.size());
+
+        for (size_t i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+
+        std::sort(order.begin(), order.end(), position_less_t<items_type>(m_items));
+
+        items_type items;
+        items.reserve(m_items.size());
+
+        for (auto it = order.begin(); it != order.end(); ++it) {
+            items.push_back(std::move(m_items[*it]));
+        }
+
+        m_items.swap(items);
+    }
+
+    if (!hashed()) {
+        m_items.erase(std::unique(m_items.begin(), m_items.end(), key_equal_t()), m_items.end());
+    }
+}
+
+void
+dynamic_t::object_t::append_hashed(item_type&& value, size_t hash) {
+    m_hashes.push_back(hash);
+
+    try {
+        m_items.push_back(std::move(value));
+    } catch (...) {
+        m_hashes.pop_back();
+        throw;
+    }
+
+    add_slot(hash, m_items.size() - 1);
+}
+
+size_t
+dynamic_t::object_t::find_hashed(const std::string& key, size_t hash) const KORA_NOEXCEPT {
+    const size_t mask = m_index.size() - 1;
+
+    // Linear probing. The table is never full, so the loop meets an empty slot.
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        const slot_t& slot = m_index[i];
+
+        if (slot.position == empty_slot) {
+            return empty_slot;
+        } else if (slot.hash == hash && m_items[slot.position].first == key) {
+            return slot.position;
+        }
+    }
+}
+
+void
+dynamic_t::object_t::reserve_index(size_t size) {
+    // Keep the load factor at most 1/2.
+    if (2 * size < m_index.size()) {
+        return;
+    }
+
+    size_t capacity = std::max<size_t>(m_index.size(), 2 * hash_threshold);
+
+    while (capacity <= 2 * size) {
+        capacity *= 2;
+    }
+
+    slot_t empty;
+    empty.hash = 0;
+    empty.position = empty_slot;
+
+    // Stored hashes are reused, so keys aren't rehashed when the table grows.
+    std::vector<slot_t> index(capacity, empty);
+    index.swap(m_index);
+
+    for (auto it = index.begin(); it != index.end(); ++it) {
+        if (it->position != empty_slot) {
+            add_slot(it->hash, it->position);
+        }
+    }
+}
+
+void
+dynamic_t::object_t::add_slot(size_t hash, size_t position) KORA_NOEXCEPT {
+    const size_t mask = m_index.size() - 1;
+
+    size_t i = hash & mask;
+
+    while (m_index[i].position != empty_slot) {
+        i = (i + 1) & mask;
+    }
+
+    m_index[i].hash = hash;
+    m_index[i].position = position;
+}
+
+void
+dynamic_t::object_t::remove_slots(size_t first, size_t last) KORA_NOEXCEPT {
+    const size_t mask = m_index.size() - 1;
+
+    for (size_t position = first; position < last; ++position) {
+        size_t i = m_hashes[position] & mask;
+
+        while (m_index[i].position != position) {
+            i = (i + 1) & mask;
+        }
+
+        // Shift back the following slots of the cluster, which would become unreachable otherwise.
+        for (size_t j = (i + 1) & mask; m_index[j].position != empty_slot; j = (j + 1) & mask) {
+            const size_t home = m_index[j].hash & mask;
+            const bool reachable = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+
+            if (!reachable) {
+                m_index[i] = m_index[j];
+                i = j;
+            }
+        }
+
+        m_index[i].position = empty_slot;
+    }
+}
+
+void
+dynamic_t::object_t::move_slot(size_t from, size_t to) KORA_NOEXCEPT {
+    const size_t mask = m_index.size() - 1;
+
+    size_t i = m_hashes[from] & mask;
+
+    while (m_index[i].position != from) {
+        i = (i + 1) & mask;
+    }
+
+    m_index[i].position = to;
+}
+
+bool
+kora::operator==(const dynamic_t::object_t& left, const dynamic_t::object_t& right) {
+    return equal_to_map(left, right, !left.hashed() && !right.hashed());
+}
+
+bool
+kora::operator!=(const dynamic_t::object_t& left, const dynamic_t::object_t& right) {
+    return !(left == right);
+}
+
+bool
+kora::operator==(const dynamic_t::object_t& left, const std::map<std::string, dynamic_t>& right) {
+    return equal_to_map(left, right, !left.hashed());
+}
+
+bool
+kora::operator==(const std::map<std::string, dynamic_t>& left, const dynamic_t::object_t& right) {
+    return equal_to_map(right, left, !right.hashed());
+}
+
+bool
+kora::operator!=(const dynamic_t::object_t& left, const std::map<std::string, dynamic_t>& right) {
+    return !(left == right);
+}
+
+bool
+kora::operator!=(const std::map<std::string, dynamic_t>& left, const dynamic_t::object_t& right) {
+    return !(left == right);
+}
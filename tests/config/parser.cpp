@@ -24,6 +24,11 @@ along with this program. If not, see <http://www.gnu.org/licenses/>.
 #include "kora/config/parser.hpp"
 
 #include <fstream>
+#include <thread>
+#include <tuple>
+
+#include <sys/stat.h>
+#include <unistd.h>
 
 TEST(ConfigParser, DefaultConstructor) {
     kora::config_parser_t parser;
@@ -258,6 +263,35 @@ namespace {
         parser.parse(stream);
     }
 
+    // Stream buffer which doesn't support seeking.
+    class unseekable_buffer_t :
+        public std::streambuf
+    {
+    public:
+        explicit
+        unseekable_buffer_t(std::string data) :
+            m_data(std::move(data))
+        {
+            char *begin = &m_data[0];
+            setg(begin, begin, begin + m_data.size());
+        }
+
+    private:
+        std::string m_data;
+    };
+
+    void
+    method_parse_unseekable_wrapper(std::string json, kora::config_parser_t &parser) {
+        unseekable_buffer_t buffer(json);
+        std::istream stream(&buffer);
+        parser.parse(stream);
+    }
+
+    void
+    method_parse_memory_wrapper(std::string json, kora::config_parser_t &parser) {
+        parser.parse(json.data(), json.size());
+    }
+
     void
     method_open_wrapper(std::string json, kora::config_parser_t &parser) {
         std::ofstream tmpfile(tmpfilename);
@@ -297,3 +331,71 @@ TEST(ConfigParser, Parse) {
 TEST(ConfigParser, Open) {
     test_parser(&method_open_wrapper);
 }
+
+TEST(ConfigParser, ParseMemory) {
+    test_parser(&method_parse_memory_wrapper);
+}
+
+TEST(ConfigParser, ParseUnseekable) {
+    test_parser(&method_parse_unseekable_wrapper);
+}
+
+namespace {
+
+    std::tuple<std::string, size_t, size_t>
+    parser_error(std::function<void(std::string, kora::config_parser_t&)> parse, const std::string &json) {
+        kora::config_parser_t parser;
+
+        try {
+            parse(json, parser);
+        } catch (const kora::config_parser_error_t &error) {
+            return std::make_tuple(std::string(error.what()), error.line_number(), error.column_number());
+        }
+
+        return std::make_tuple(std::string(), 0, 0);
+    }
+
+    void
+    test_same_errors(const std::string &json) {
+        auto expected = parser_error(&method_parse_wrapper, json);
+
+        ASSERT_FALSE(std::get<0>(expected).empty());
+        EXPECT_EQ(expected, parser_error(&method_parse_memory_wrapper, json));
+        EXPECT_EQ(expected, parser_error(&method_open_wrapper, json));
+
+        // The unseekable stream may be consumed by the logging filter, so the error line may be incomplete.
+        auto unseekable = parser_error(&method_parse_unseekable_wrapper, json);
+        EXPECT_EQ(std::get<1>(expected), std::get<1>(unseekable));
+        EXPECT_EQ(std::get<2>(expected), std::get<2>(unseekable));
+    }
+
+} // namespace
+
+TEST(ConfigParser, AllMethodsReportSameErrors) {
+    test_same_errors("{\n    \"key1\": -1,\n\t\"key2\": tru\n}\n");
+    test_same_errors("{\n    \"key1\": -1\n}\n\n  garbage\n");
+    test_same_errors("\n\n  [1,\n 2]\n");
+    test_same_errors("{\"key\": [1, 2,\n");
+    test_same_errors("   \n");
+}
+
+TEST(ConfigParser, OpenNamedPipe) {
+    const std::string path = "config_parser_test_tmp_fifo_dont_touch_this_ijhiu47837y8hc";
+
+    ::unlink(path.c_str());
+    ASSERT_EQ(0, ::mkfifo(path.c_str(), 0600));
+
+    // The writer is blocked until the parser opens the pipe, and the pipe must be opened once.
+    std::thread writer([&path]() {
+        std::ofstream pipe(path.c_str());
+        pipe << "{\"key\": [1, 2]}\n";
+    });
+
+    kora::config_parser_t parser;
+    kora::config_t config = parser.open(path);
+
+    writer.join();
+    ::unlink(path.c_str());
+
+    EXPECT_EQ(2, config.at("key").size());
+}
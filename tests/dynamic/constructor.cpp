@@ -122,6 +122,23 @@ TEST(DynamicConstructor, Vector) {
     EXPECT_EQ(kora::dynamic_t::array_t(3, kora::dynamic_t::bool_t(true)), assigned.as_array());
 }
 
+TEST(DynamicConstructor, VectorRvalue) {
+    std::vector<std::string> strings(3, std::string(100, 'x'));
+    const char *data = strings[1].data();
+
+    kora::dynamic_t constructed = std::move(strings);
+    EXPECT_EQ(kora::dynamic_t::array_t(3, std::string(100, 'x')), constructed.as_array());
+    EXPECT_EQ(data, constructed.as_array()[1].as_string_view().data());
+
+    std::vector<kora::dynamic_t> values(3, kora::dynamic_t::array_t(2, 5));
+    const kora::dynamic_t *buffer = values.data();
+
+    kora::dynamic_t assigned;
+    assigned = std::move(values);
+    EXPECT_EQ(kora::dynamic_t::array_t(3, kora::dynamic_t::array_t(2, 5)), assigned.as_array());
+    EXPECT_EQ(buffer, assigned.as_array().data());
+}
+
 TEST(DynamicConstructor, Tuple) {
     kora::dynamic_t::array_t pattern;
     pattern.push_back(kora::dynamic_t::null);
@@ -173,6 +190,26 @@ TEST(DynamicConstructor, Map) {
     EXPECT_EQ(assigned.as_object()["key2"].as_bool(), false);
 }
 
+TEST(DynamicConstructor, MapRvalue) {
+    std::map<std::string, std::string> map;
+    map["key1"] = std::string(100, 'x');
+    map["key2"] = std::string(100, 'y');
+    const char *data = map["key2"].data();
+
+    kora::dynamic_t constructed = std::move(map);
+    EXPECT_EQ(2, constructed.as_object().size());
+    EXPECT_EQ(std::string(100, 'x'), constructed.as_object()["key1"]);
+    EXPECT_EQ(data, constructed.as_object()["key2"].as_string_view().data());
+
+    std::map<std::string, kora::dynamic_t> dynamic_map;
+    dynamic_map["key"] = std::string(100, 'z');
+    data = dynamic_map["key"].as_string_view().data();
+
+    kora::dynamic_t assigned;
+    assigned = std::move(dynamic_map);
+    EXPECT_EQ(data, assigned.as_object()["key"].as_string_view().data());
+}
+
 TEST(DynamicConstructor, UnorderedMap) {
     std::unordered_map<std::string, bool> map;
     map["key1"] = true;
@@ -192,6 +229,18 @@ TEST(DynamicConstructor, UnorderedMap) {
     EXPECT_EQ(assigned.as_object()["key2"].as_bool(), false);
 }
 
+TEST(DynamicConstructor, UnorderedMapRvalue) {
+    std::unordered_map<std::string, std::vector<std::string>> map;
+    map["key1"] = std::vector<std::string>(2, std::string(100, 'x'));
+    map["key2"] = std::vector<std::string>();
+    const char *data = map["key1"][1].data();
+
+    kora::dynamic_t constructed = std::move(map);
+    EXPECT_EQ(2, constructed.as_object().size());
+    EXPECT_EQ(kora::dynamic_t::array_t(), constructed.as_object()["key2"]);
+    EXPECT_EQ(data, constructed.as_object()["key1"].as_array()[1].as_string_view().data());
+}
+
 namespace {
 
     struct test_struct_t {
@@ -0,0 +1,254 @@
+/*
+Copyright (c) 2014 Andrey Goryachev <andrey.goryachev@gmail.com>
+Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+This file is part of Kora.
+
+Kora is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 3 of the License, or
+(at your option) any later version.
+
+Kora is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include "kora/dynamic.hpp"
+
+#include <sstream>
+
+TEST(Document, EmptyDocument) {
+    kora::document_t document;
+    EXPECT_TRUE(document.root().is_null());
+    EXPECT_EQ(0, document.capacity());
+}
+
+TEST(Document, MakeValues) {
+    kora::document_t document;
+
+    const std::string long_string(100, 'x');
+
+    kora::dynamic_t string = document.make_string(long_string);
+    EXPECT_TRUE(string.is_string());
+    EXPECT_EQ(long_string, string.as_string());
+    EXPECT_EQ('\0', string.as_string_view().data()[long_string.size()]);
+
+    kora::dynamic_t short_string = document.make_string("ok");
+    EXPECT_EQ("ok", short_string);
+
+    kora::dynamic_t array = document.make_array(kora::dynamic_t::array_t(3, 4));
+    EXPECT_TRUE(array.is_array());
+    EXPECT_EQ(kora::dynamic_t(kora::dynamic_t::array_t(3, 4)), array);
+
+    kora::dynamic_t object = document.make_object();
+    EXPECT_TRUE(object.is_object());
+    object.as_object()["key"] = std::move(string);
+    array.as_array().push_back(std::move(object));
+
+    document.root() = std::move(array);
+
+    EXPECT_EQ(long_string, document.root().as_array()[3].as_object()["key"]);
+    EXPECT_LT(0, document.capacity());
+}
+
+TEST(Document, CopiesDoNotReferToDocument) {
+    kora::dynamic_t copy;
+
+    {
+        kora::document_t document;
+
+        kora::dynamic_t::object_t object;
+        object["key"] = document.make_string(std::string(50, 'y'));
+
+        document.root() = document.make_array(kora::dynamic_t::array_t(1, document.make_object(object)));
+        copy = document.root();
+    }
+
+    EXPECT_EQ(std::string(50, 'y'), copy.as_array()[0].as_object()["key"].as_string());
+}
+
+TEST(Document, MutateStringOfDocument) {
+    kora::document_t document;
+
+    document.root() = document.make_string(std::string(20, 'z'));
+    document.root().as_string() += "!";
+
+    EXPECT_EQ(std::string(20, 'z') + "!", document.root().as_string());
+}
+
+TEST(Document, ReadJson) {
+    const std::string json = "{\"key\": [1, \"a rather long string value\", {\"nested\": null}], \"short\": \"ok\"}";
+
+    kora::document_t document;
+    kora::dynamic_t& root = kora::dynamic::read_json(json.data(), json.size(), document);
+
+    EXPECT_EQ(&document.root(), &root);
+    EXPECT_EQ(kora::dynamic::read_json(json), root);
+
+    std::istringstream input(json);
+    EXPECT_EQ(kora::dynamic::read_json(json), kora::dynamic::read_json(input, document));
+}
+
+TEST(Document, ClearKeepsLargestBlock) {
+    kora::document_t document;
+
+    for (size_t i = 0; i < 1000; ++i) {
+        document.make_string(std::string(1000, 'x'));
+    }
+
+    const size_t capacity = document.capacity();
+
+    document.clear();
+    EXPECT_TRUE(document.root().is_null());
+    EXPECT_LT(0, document.capacity());
+    EXPECT_GT(capacity, document.capacity());
+
+    const std::string json = "[\"a rather long string value\", \"another rather long string value\"]";
+    kora::dynamic::read_json(json.data(), json.size(), document);
+    EXPECT_EQ(kora::dynamic::read_json(json), document.root());
+}
+
+TEST(Document, StringInterning) {
+    std::string json = "[";
+
+    for (size_t i = 0; i < 1000; ++i) {
+        json += (i == 0 ? "" : ",");
+        json += "{\"a rather long key name\": \"a rather long string value repeated in every record\", ";
+        json += "\"id\": " + std::to_string(i) + "}";
+    }
+
+    json += "]";
+
+    kora::document_t plain;
+    kora::dynamic::read_json(json.data(), json.size(), plain);
+
+    kora::document_t interned;
+    EXPECT_FALSE(interned.string_interning());
+    interned.set_string_interning(true);
+    EXPECT_TRUE(interned.string_interning());
+
+    const kora::dynamic_t& root = kora::dynamic::read_json(json.data(), json.size(), interned);
+
+    EXPECT_EQ(plain.root(), root);
+    EXPECT_GT(plain.capacity(), interned.capacity());
+
+    const auto& records = root.as_array();
+
+    EXPECT_EQ(
+        records[0].as_object().at("a rather long key name").as_string_view().data(),
+        records[999].as_object().at("a rather long key name").as_string_view().data()
+    );
+
+    EXPECT_EQ(
+        records[0].as_object().at("a rather long key name").as_string_view().data(),
+        interned.make_string("a rather long string value repeated in every record").as_string_view().data()
+    );
+
+    // Interned strings are copied on modification.
+    interned.root().as_array()[0].as_object()["a rather long key name"].as_string() += "!";
+    EXPECT_EQ(
+        "a rather long string value repeated in every record",
+        records[1].as_object().at("a rather long key name")
+    );
+
+    interned.clear();
+    EXPECT_TRUE(interned.string_interning());
+    EXPECT_EQ(plain.root(), kora::dynamic::read_json(json.data(), json.size(), interned));
+}
+
+TEST(Document, KeysAreNotInterned) {
+    // Only the keys are long, and they are stored by the objects, not by the document.
+    std::string json = "[";
+
+    for (size_t i = 0; i < 1000; ++i) {
+        json += (i == 0 ? "" : ",");
+        json += "{\"a rather long key name\": [{\"another rather long key name\": " + std::to_string(i) + "}]}";
+    }
+
+    json += "]";
+
+    kora::document_t plain;
+    kora::dynamic::read_json(json.data(), json.size(), plain);
+
+    kora::document_t interned;
+    interned.set_string_interning(true);
+    kora::dynamic::read_json(json.data(), json.size(), interned);
+
+    EXPECT_EQ(kora::dynamic::read_json(json.data(), json.size()), interned.root());
+    EXPECT_EQ(plain.capacity(), interned.capacity());
+
+    // Values in any position are still created by the document.
+    const std::string nested = "{\"a rather long key name\": [\"a rather long string value\", "
+                               "{\"k\": \"a rather long string value\"}], \"x\": \"a rather long string value\"}";
+
+    const kora::dynamic_t& root = kora::dynamic::read_json(nested.data(), nested.size(), interned);
+    const auto& object = root.as_object();
+    const char *data = object.at("x").as_string_view().data();
+
+    EXPECT_EQ(data, object.at("a rather long key name").as_array()[0].as_string_view().data());
+    EXPECT_EQ(data, object.at("a rather long key name").as_array()[1].as_object().at("k").as_string_view().data());
+}
+
+TEST(Document, CopyDeepTree) {
+    kora::dynamic_t copy;
+
+    {
+        kora::document_t document;
+
+        kora::dynamic_t tree = document.make_string(std::string(20, 'x'));
+
+        for (size_t i = 0; i < 200000; ++i) {
+            kora::dynamic_t array = document.make_array();
+            array.as_array().push_back(std::move(tree));
+            array.as_array().push_back(document.make_object());
+            tree = std::move(array);
+        }
+
+        copy = tree;
+        EXPECT_EQ(tree, copy);
+    }
+
+    const kora::dynamic_t *value = &copy;
+
+    for (size_t i = 0; i < 200000; ++i) {
+        ASSERT_EQ(2, value->as_array().size());
+        EXPECT_TRUE(value->as_array()[1].as_object().empty());
+        value = &value->as_array()[0];
+    }
+
+    EXPECT_EQ(std::string(20, 'x'), *value);
+}
+
+TEST(Document, MovedValuesReferToDocument) {
+    kora::document_t document;
+
+    kora::dynamic_t array = document.make_array();
+    array.as_array().push_back(document.make_string(std::string(20, 'x')));
+    document.root() = std::move(array);
+
+    const char *data = document.root().as_array()[0].as_string_view().data();
+
+    // Moving doesn't copy anything, so the value must be destroyed before the document is cleared.
+    kora::dynamic_t moved = std::move(document.root());
+    EXPECT_TRUE(document.root().is_null());
+
+    const kora::dynamic_t& moved_ref = moved;
+    EXPECT_EQ(data, moved_ref.as_array()[0].as_string_view().data());
+
+    // The copy doesn't refer to the document.
+    kora::dynamic_t copy = moved;
+    const kora::dynamic_t& copy_ref = copy;
+    EXPECT_NE(data, copy_ref.as_array()[0].as_string_view().data());
+
+    moved = kora::dynamic_t();
+    document.clear();
+
+    EXPECT_EQ(std::string(20, 'x'), copy_ref.as_array()[0]);
+}
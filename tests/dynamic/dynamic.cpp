@@ -23,6 +23,9 @@ along with this program. If not, see <http://www.gnu.org/licenses/>.
 
 #include "kora/dynamic.hpp"
 
+#include <thread>
+#include <unordered_set>
+
 TEST(Dynamic, AssociatedItems) {
     kora::dynamic_t::bool_t bool_variable;
     (void)bool_variable;
@@ -98,6 +101,65 @@ TEST(Dynamic, StringMoveConstructor) {
     EXPECT_EQ("xdd", dynamic.as_string());
 }
 
+TEST(Dynamic, StringViewConstructor) {
+    kora::dynamic_t dynamic = kora::string_view_t("xdd");
+    EXPECT_TRUE(dynamic.is_string());
+    EXPECT_EQ("xdd", dynamic.as_string());
+}
+
+TEST(Dynamic, StringsOfDifferentLength) {
+    for (size_t size = 0; size < 40; ++size) {
+        const kora::dynamic_t::string_t source(size, 'x');
+
+        kora::dynamic_t copied = source;
+        kora::dynamic_t moved = kora::dynamic_t::string_t(source);
+        kora::dynamic_t viewed = kora::string_view_t(source);
+
+        EXPECT_TRUE(copied.is_string());
+        EXPECT_EQ(source, copied.as_string());
+        EXPECT_EQ(source, moved.as_string());
+        EXPECT_EQ(source, viewed.as_string());
+        EXPECT_EQ(copied, moved);
+        EXPECT_EQ(copied, viewed);
+
+        EXPECT_EQ(size, copied.as_string_view().size());
+        EXPECT_EQ('\0', copied.as_string_view().data()[size]);
+        EXPECT_STREQ(source.c_str(), copied.to<const char*>());
+
+        kora::dynamic_t copy = copied;
+        EXPECT_EQ(source, copy.as_string_view().str());
+    }
+}
+
+TEST(Dynamic, StringViewDoesNotCopy) {
+    const kora::dynamic_t dynamic = kora::dynamic_t::string_t(100, 'x');
+    EXPECT_EQ(dynamic.as_string_view().data(), dynamic.as_string_view().data());
+
+    EXPECT_THROW(kora::dynamic_t(5).as_string_view(), kora::expected_string_t);
+}
+
+TEST(Dynamic, ShortStringMutation) {
+    kora::dynamic_t dynamic = "ok";
+    dynamic.as_string() += " and a much longer suffix";
+
+    EXPECT_EQ("ok and a much longer suffix", dynamic.as_string_view().str());
+}
+
+TEST(Dynamic, ConstStringCopy) {
+    const kora::dynamic_t dynamic = "ok";
+    const char *data = dynamic.as_string_view().data();
+
+    // The inline string isn't moved to the heap by const access.
+    const kora::dynamic_t::string_t& string = dynamic.as_string();
+    EXPECT_EQ("ok", string);
+    EXPECT_STREQ("ok", dynamic.as_string().c_str());
+    EXPECT_EQ(data, dynamic.as_string_view().data());
+    EXPECT_NE(string.data(), data);
+
+    EXPECT_EQ("ok", dynamic.to<std::string>());
+    EXPECT_THROW(kora::dynamic_t::empty_array.as_string(), kora::expected_string_t);
+}
+
 TEST(Dynamic, ArrayConstructor) {
     kora::dynamic_t dynamic = kora::dynamic_t::array_t(3, 4);
     EXPECT_TRUE(dynamic.is_array());
@@ -252,6 +314,188 @@ TEST(Dynamic, MoveConstructor) {
     }
 }
 
+TEST(Dynamic, CompactRepresentation) {
+    EXPECT_LE(sizeof(kora::dynamic_t), 2 * sizeof(kora::dynamic_t::uint_t));
+}
+
+TEST(Dynamic, AssignmentFromSubobject) {
+    {
+        kora::dynamic_t dynamic = kora::dynamic_t::array_t(1, kora::dynamic_t::array_t(2, 7));
+        dynamic = dynamic.as_array()[0];
+
+        EXPECT_EQ(kora::dynamic_t(kora::dynamic_t::array_t(2, 7)), dynamic);
+    }
+    {
+        kora::dynamic_t dynamic = kora::dynamic_t::object_t();
+        dynamic.as_object()["key"] = "value";
+        dynamic = std::move(dynamic.as_object()["key"]);
+
+        EXPECT_EQ("value", dynamic);
+    }
+}
+
+TEST(Dynamic, CopiesShareContainers) {
+    kora::dynamic_t::object_t object;
+    object["array"] = kora::dynamic_t::array_t(3, 4);
+    kora::dynamic_t dynamic = std::move(object);
+
+    const kora::dynamic_t& original = dynamic;
+    const kora::dynamic_t copy = dynamic;
+    EXPECT_EQ(&original.as_object(), &copy.as_object());
+
+    // Modification copies only the modified containers.
+    dynamic.as_object()["key"] = 5;
+    EXPECT_NE(&original.as_object(), &copy.as_object());
+    EXPECT_EQ(&original.as_object().at("array").as_array(), &copy.as_object().at("array").as_array());
+
+    dynamic.as_object()["array"].as_array().push_back(6);
+
+    EXPECT_EQ(1, copy.as_object().size());
+    EXPECT_EQ(kora::dynamic_t::array_t(3, 4), copy.as_object().at("array"));
+    EXPECT_EQ(4, dynamic.as_object()["array"].as_array().size());
+}
+
+TEST(Dynamic, UnsharedContainerIsNotCopied) {
+    kora::dynamic_t dynamic = kora::dynamic_t::array_t(3, 4);
+    const kora::dynamic_t::array_t *array = &dynamic.as_array();
+
+    {
+        kora::dynamic_t copy = dynamic;
+    }
+
+    EXPECT_EQ(array, &dynamic.as_array());
+}
+
+TEST(Dynamic, ReferencedContainerIsNotShared) {
+    kora::dynamic_t dynamic = kora::dynamic_t::array_t(3, 4);
+    kora::dynamic_t::array_t& array = dynamic.as_array();
+
+    // The copy doesn't see the modifications made through the reference.
+    const kora::dynamic_t copy = dynamic;
+    EXPECT_NE(&array, &copy.as_array());
+
+    array.push_back(5);
+    EXPECT_EQ(kora::dynamic_t::array_t(3, 4), copy);
+    EXPECT_EQ(4, dynamic.as_array().size());
+
+    // Copies of the copy share it as usual.
+    const kora::dynamic_t second_copy = copy;
+    EXPECT_EQ(&copy.as_array(), &second_copy.as_array());
+
+    kora::dynamic_t emplaced;
+    emplaced.emplace_object()["key"] = 1;
+    EXPECT_NE(&static_cast<const kora::dynamic_t&>(emplaced).as_object(), &kora::dynamic_t(emplaced).as_object());
+}
+
+TEST(Dynamic, InsertionIntoItself) {
+    kora::dynamic_t array = kora::dynamic_t::array_t(1, 5);
+    array.as_array().push_back(array);
+
+    kora::dynamic_t::array_t expected(1, 5);
+    expected.push_back(kora::dynamic_t::array_t(1, 5));
+    EXPECT_EQ(kora::dynamic_t(expected), array);
+
+    kora::dynamic_t object = kora::dynamic_t::object_t();
+    object.as_object()["self"] = object;
+    object.as_object()["self"] = object;
+
+    EXPECT_EQ("{\"self\":{\"self\":{\"self\":null}}}", kora::to_json(object));
+}
+
+TEST(Dynamic, SharedContainersInThreads) {
+    kora::dynamic_t dynamic = kora::dynamic_t::array_t(100, kora::dynamic_t::array_t(10, 1));
+
+    std::vector<std::thread> threads;
+
+    for (size_t i = 0; i < 4; ++i) {
+        threads.push_back(std::thread([&dynamic]() {
+            for (size_t j = 0; j < 1000; ++j) {
+                kora::dynamic_t copy = static_cast<const kora::dynamic_t&>(dynamic);
+                copy.as_array()[j % 100].as_array().push_back(2);
+                EXPECT_EQ(11, copy.as_array()[j % 100].as_array().size());
+            }
+        }));
+    }
+
+    for (auto it = threads.begin(); it != threads.end(); ++it) {
+        it->join();
+    }
+
+    EXPECT_EQ(kora::dynamic_t(kora::dynamic_t::array_t(100, kora::dynamic_t::array_t(10, 1))), dynamic);
+}
+
+TEST(Dynamic, SharedStringsInThreads) {
+    kora::dynamic_t::object_t object;
+    object["short"] = kora::dynamic_t::array_t(1000, "short");
+    object["long"] = kora::dynamic_t::array_t(1000, std::string(50, 'x'));
+
+    const kora::dynamic_t dynamic = object;
+
+    std::vector<std::thread> threads;
+
+    for (size_t i = 0; i < 4; ++i) {
+        threads.push_back(std::thread([&dynamic]() {
+            // Every thread reads its own copy, while the copies share the containers.
+            const kora::dynamic_t copy = dynamic;
+
+            const kora::dynamic_t::array_t& short_strings = copy.as_object().at("short").as_array();
+            const kora::dynamic_t::array_t& long_strings = copy.as_object().at("long").as_array();
+
+            for (size_t j = 0; j < 1000; ++j) {
+                EXPECT_EQ("short", short_strings[j].as_string());
+                EXPECT_EQ("short", short_strings[j].to<std::string>());
+                EXPECT_EQ(std::string(50, 'x'), long_strings[j].as_string());
+                EXPECT_EQ(5, short_strings[j].as_string_view().size());
+            }
+
+            EXPECT_EQ(kora::dynamic_t(kora::dynamic_t::array_t(1000, "short")), copy.as_object().at("short"));
+        }));
+    }
+
+    for (auto it = threads.begin(); it != threads.end(); ++it) {
+        it->join();
+    }
+
+    EXPECT_EQ(kora::dynamic_t(object), dynamic);
+}
+
+namespace {
+
+kora::dynamic_t
+make_deep_tree(size_t depth, int leaf) {
+    kora::dynamic_t result = leaf;
+
+    for (size_t i = 0; i < depth; ++i) {
+        if (i % 2 == 0) {
+            result = kora::dynamic_t::array_t(1, std::move(result));
+        } else {
+            kora::dynamic_t::object_t object;
+            object["key"] = std::move(result);
+            result = std::move(object);
+        }
+    }
+
+    return result;
+}
+
+} // namespace
+
+// Such trees overflow the stack if they are traversed recursively.
+TEST(Dynamic, DeepTree) {
+    kora::dynamic_t tree = make_deep_tree(200000, 1);
+
+    EXPECT_EQ(make_deep_tree(200000, 1), tree);
+    EXPECT_NE(make_deep_tree(200000, 2), tree);
+    EXPECT_NE(make_deep_tree(199999, 1), tree);
+    EXPECT_EQ(kora::hash_value(make_deep_tree(200000, 1)), kora::hash_value(tree));
+
+    kora::dynamic_t copy = tree;
+    EXPECT_EQ(tree, copy);
+
+    tree = kora::dynamic_t::null;
+    EXPECT_EQ(make_deep_tree(200000, 1), copy);
+}
+
 TEST(Dynamic, NullAssignment) {
     kora::dynamic_t dynamic;
     dynamic = kora::dynamic_t::null_t();
@@ -318,6 +562,48 @@ TEST(Dynamic, ObjectAssignment) {
     EXPECT_EQ(43, dynamic.as_object()["key"]);
 }
 
+TEST(Dynamic, EmplaceArray) {
+    kora::dynamic_t dynamic = "a string which doesn't fit inline";
+    kora::dynamic_t::array_t& array = dynamic.emplace_array(10);
+
+    EXPECT_TRUE(dynamic.is_array());
+    EXPECT_TRUE(array.empty());
+    EXPECT_LE(10, array.capacity());
+
+    array.push_back(1);
+    array.push_back(2);
+    EXPECT_EQ(kora::dynamic_t::array_t({1, 2}), dynamic.as_array());
+    EXPECT_EQ(&array, &dynamic.as_array());
+}
+
+TEST(Dynamic, EmplaceObject) {
+    kora::dynamic_t dynamic = 5;
+    kora::dynamic_t::object_t& object = dynamic.emplace_object(2);
+
+    EXPECT_TRUE(dynamic.is_object());
+    EXPECT_TRUE(object.empty());
+
+    object["key"] = 43;
+    object["nested"].emplace_array().push_back("value");
+
+    EXPECT_EQ(&object, &dynamic.as_object());
+    EXPECT_EQ(43, dynamic.as_object().at("key"));
+    EXPECT_EQ(kora::dynamic_t::array_t(1, "value"), dynamic.as_object().at("nested"));
+}
+
+TEST(Dynamic, EmplaceDoesNotAffectCopies) {
+    kora::dynamic_t dynamic = kora::dynamic_t::array_t(3, 4);
+    const kora::dynamic_t copy = dynamic;
+
+    dynamic.emplace_array().push_back(5);
+    EXPECT_EQ(kora::dynamic_t::array_t(1, 5), dynamic);
+    EXPECT_EQ(kora::dynamic_t::array_t(3, 4), copy);
+
+    kora::dynamic_t nested = kora::dynamic_t::array_t(1, kora::dynamic_t::array_t(3, 4));
+    nested.as_array()[0].emplace_object()["key"] = 1;
+    EXPECT_EQ(1, nested.as_array()[0].as_object().at("key"));
+}
+
 TEST(Dynamic, CopyAssignment) {
     {
         kora::dynamic_t dyn1;
@@ -475,6 +761,26 @@ TEST(Dynamic, MoveAssignment) {
     }
 }
 
+TEST(Dynamic, Swap) {
+    kora::dynamic_t string = "a string which doesn't fit inline";
+    kora::dynamic_t short_string = "short";
+    kora::dynamic_t array = kora::dynamic_t::array_t(3, 4);
+    const kora::dynamic_t::array_t *array_data = &array.as_array();
+
+    string.swap(array);
+    EXPECT_EQ(kora::dynamic_t::array_t(3, 4), string);
+    EXPECT_EQ(array_data, &string.as_array());
+    EXPECT_EQ("a string which doesn't fit inline", array);
+
+    using std::swap;
+    swap(array, short_string);
+    EXPECT_EQ("short", array);
+    EXPECT_EQ("a string which doesn't fit inline", short_string);
+
+    swap(array, array);
+    EXPECT_EQ("short", array);
+}
+
 namespace {
     void
     test_copy_equality(const kora::dynamic_t& original) {
@@ -687,6 +993,161 @@ TEST(Dynamic, InequalityObject) {
     basic_inequality_checks_nonnull(dynamic);
 }
 
+TEST(Dynamic, HashOfEqualValues) {
+    std::hash<kora::dynamic_t> hash;
+
+    EXPECT_EQ(hash(kora::dynamic_t()), hash(kora::dynamic_t::null));
+    EXPECT_EQ(hash(true), hash(kora::dynamic_t(true)));
+
+    EXPECT_EQ(hash(kora::dynamic_t::int_t(5)), hash(kora::dynamic_t::uint_t(5)));
+    EXPECT_EQ(hash(kora::dynamic_t::int_t(5)), hash(kora::dynamic_t::double_t(5)));
+    EXPECT_EQ(hash(kora::dynamic_t::uint_t(5)), hash(kora::dynamic_t::double_t(5)));
+    EXPECT_EQ(hash(kora::dynamic_t::int_t(0)), hash(kora::dynamic_t::double_t(-0.0)));
+
+    kora::document_t document;
+    const std::string long_string = "a string which doesn't fit inline";
+    EXPECT_EQ(hash(long_string), hash(document.make_string(long_string)));
+    EXPECT_EQ(hash("short"), hash(document.make_string("short")));
+
+    kora::dynamic_t::array_t array;
+    array.push_back(kora::dynamic_t::int_t(1));
+    array.push_back(long_string);
+    EXPECT_EQ(hash(array), hash(kora::dynamic_t::array_t({1.0, long_string})));
+
+    // The items of large objects are stored in the order of insertion.
+    kora::dynamic_t::object_t forward;
+    kora::dynamic_t::object_t backward;
+
+    for (int i = 0; i < 100; ++i) {
+        forward["key-" + std::to_string(i)] = i;
+        backward["key-" + std::to_string(99 - i)] = kora::dynamic_t::uint_t(99 - i);
+    }
+
+    ASSERT_EQ(kora::dynamic_t(forward), kora::dynamic_t(backward));
+    EXPECT_EQ(hash(forward), hash(backward));
+}
+
+TEST(Dynamic, HashOfDifferentValues) {
+    std::hash<kora::dynamic_t> hash;
+
+    EXPECT_NE(hash(false), hash(true));
+    EXPECT_NE(hash(kora::dynamic_t::null), hash(false));
+    EXPECT_NE(hash(5), hash(6));
+    EXPECT_NE(hash(5), hash("5"));
+    EXPECT_NE(hash("abcdefgh"), hash("abcdefgi"));
+    EXPECT_NE(hash(kora::dynamic_t::array_t()), hash(kora::dynamic_t::object_t()));
+    EXPECT_NE(hash(kora::dynamic_t::array_t({1, 2})), hash(kora::dynamic_t::array_t({2, 1})));
+    EXPECT_NE(hash(kora::dynamic_t::array_t({1, 2})), hash(kora::dynamic_t::array_t({1, 2, 2})));
+
+    kora::dynamic_t::object_t object;
+    object["a"] = 1;
+    object["b"] = 2;
+
+    kora::dynamic_t::object_t swapped;
+    swapped["a"] = 2;
+    swapped["b"] = 1;
+
+    EXPECT_NE(hash(object), hash(swapped));
+}
+
+TEST(Dynamic, SavedHashIsForgottenOnModification) {
+    auto make_tree = [](int value) -> kora::dynamic_t {
+        kora::dynamic_t::object_t record;
+        record["tags"] = kora::dynamic_t::array_t({1, 2});
+        record["value"] = value;
+
+        return kora::dynamic_t::array_t(1, record);
+    };
+
+    kora::dynamic_t tree = make_tree(1);
+    const size_t hash = kora::hash_value(tree);
+    EXPECT_EQ(hash, kora::hash_value(tree));
+
+    tree.as_array()[0].as_object()["value"] = 2;
+    EXPECT_EQ(kora::hash_value(make_tree(2)), kora::hash_value(tree));
+    EXPECT_NE(hash, kora::hash_value(tree));
+
+    tree.as_array()[0].as_object()["value"] = 1;
+    EXPECT_EQ(hash, kora::hash_value(tree));
+
+    // The copy shares the saved hash, and the modified value gets its own container.
+    const kora::dynamic_t copy = tree;
+    tree.as_array().push_back(3);
+    EXPECT_EQ(hash, kora::hash_value(copy));
+    EXPECT_NE(hash, kora::hash_value(tree));
+}
+
+TEST(Dynamic, ModificationThroughReferenceAfterHashing) {
+    kora::dynamic_t root = kora::dynamic_t::object_t();
+    kora::dynamic_t& x = root.as_object()["x"];
+    x = kora::dynamic_t::object_t();
+
+    kora::hash_value(root);
+    const kora::dynamic_t before = root;
+    kora::hash_value(before);
+
+    // Neither the modified container nor its ancestors keep an outdated hash.
+    x.as_object()["k"] = 1;
+    EXPECT_NE(before, root);
+    EXPECT_NE(kora::hash_value(before), kora::hash_value(root));
+
+    kora::dynamic_t::object_t expected;
+    expected["x"] = kora::dynamic_t::object_t();
+    expected["x"].as_object()["k"] = 1;
+    const kora::dynamic_t hashed_expected = expected;
+    EXPECT_EQ(kora::hash_value(hashed_expected), kora::hash_value(root));
+    EXPECT_EQ(hashed_expected, root);
+}
+
+TEST(Dynamic, ComparisonOfHashedValues) {
+    auto make_tree = [](int value) -> kora::dynamic_t {
+        kora::dynamic_t::array_t records;
+
+        for (int i = 0; i < 100; ++i) {
+            kora::dynamic_t::object_t record;
+            record["id"] = i;
+            record["value"] = i == 50 ? value : 0;
+            records.push_back(record);
+        }
+
+        return records;
+    };
+
+    const kora::dynamic_t tree = make_tree(1);
+    const kora::dynamic_t equal = make_tree(1);
+    const kora::dynamic_t different = make_tree(2);
+
+    kora::hash_value(tree);
+    EXPECT_EQ(tree, equal);
+    EXPECT_NE(tree, different);
+
+    kora::hash_value(equal);
+    kora::hash_value(different);
+    EXPECT_EQ(tree, equal);
+    EXPECT_NE(tree, different);
+    EXPECT_NE(different, tree);
+
+    // Equal numbers of different types have equal hashes.
+    const kora::dynamic_t integers = kora::dynamic_t::array_t(1, 1);
+    const kora::dynamic_t doubles = kora::dynamic_t::array_t(1, 1.0);
+    kora::hash_value(integers);
+    kora::hash_value(doubles);
+    EXPECT_EQ(integers, doubles);
+}
+
+TEST(Dynamic, HashedContainers) {
+    std::unordered_set<kora::dynamic_t> set;
+
+    set.insert(kora::dynamic_t::array_t({1, 2}));
+    set.insert(kora::dynamic_t::array_t({1.0, 2.0}));
+    set.insert(kora::dynamic_t::object_t());
+    set.insert(kora::dynamic_t::int_t(-1));
+    set.insert(kora::dynamic_t::double_t(-1));
+
+    EXPECT_EQ(3, set.size());
+    EXPECT_EQ(1, set.count(kora::dynamic_t::array_t({kora::dynamic_t::uint_t(1), 2})));
+}
+
 namespace {
 
     template<class Expected>
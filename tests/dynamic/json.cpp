@@ -25,8 +25,13 @@ along with this program. If not, see <http://www.gnu.org/licenses/>.
 
 #include <boost/lexical_cast.hpp>
 
+#include <cmath>
+#include <cstring>
 #include <functional>
+#include <memory>
+#include <random>
 #include <sstream>
+#include <stdexcept>
 
 namespace {
 
@@ -188,11 +193,574 @@ TEST(DynamicJson, ArrayParsing) {
     check_parsed_array(kora::dynamic::read_json(input));
 }
 
+TEST(DynamicJson, LeavesTheRestOfTheStream) {
+    std::istringstream input("{\"key\": 1} [2, 3]\n  some garbage");
+
+    kora::dynamic_t first = kora::dynamic::read_json(input);
+    ASSERT_TRUE(first.is_object());
+    EXPECT_EQ(1, first.as_object()["key"]);
+
+    kora::dynamic_t second = kora::dynamic::read_json(input);
+    ASSERT_TRUE(second.is_array());
+    EXPECT_EQ(2, second.as_array().size());
+
+    std::string rest;
+    std::getline(input, rest);
+    EXPECT_EQ("some garbage", rest);
+}
+
+TEST(DynamicJson, SetsEofAfterTheLastValue) {
+    std::istringstream input("[1, 2]\n");
+
+    kora::dynamic::read_json(input);
+    EXPECT_TRUE(input.eof());
+}
+
+TEST(DynamicJson, LargeInputParsing) {
+    kora::dynamic_t::array_t array;
+
+    for (int i = 0; i < 10000; ++i) {
+        kora::dynamic_t::object_t item;
+        item["index"] = i;
+        item["name"] = "item" + boost::lexical_cast<std::string>(i);
+        array.emplace_back(std::move(item));
+    }
+
+    std::istringstream input(kora::to_json(array) + "tail");
+
+    EXPECT_EQ(kora::dynamic_t(array), kora::dynamic::read_json(input));
+
+    std::string rest;
+    std::getline(input, rest);
+    EXPECT_EQ("tail", rest);
+}
+
+namespace {
+
+    // Stream buffer which makes only a few characters available at a time.
+    class trickling_buffer_t :
+        public std::streambuf
+    {
+    public:
+        trickling_buffer_t(std::string data, size_t portion) :
+            m_data(std::move(data)),
+            m_position(0),
+            m_portion(portion)
+        { }
+
+    protected:
+        int_type
+        underflow() {
+            if (m_position == m_data.size()) {
+                return traits_type::eof();
+            }
+
+            char *begin = &m_data[m_position];
+            m_position = std::min(m_data.size(), m_position + m_portion);
+            setg(begin, begin, &m_data[0] + m_position);
+
+            return traits_type::to_int_type(*begin);
+        }
+
+    private:
+        std::string m_data;
+        size_t m_position;
+        size_t m_portion;
+    };
+
+} // namespace
+
+TEST(DynamicJson, TricklingInputParsing) {
+    kora::dynamic_t::array_t array;
+
+    for (int i = 0; i < 10000; ++i) {
+        array.emplace_back("item" + boost::lexical_cast<std::string>(i));
+    }
+
+    const std::string json = kora::to_json(array);
+
+    // The blocks grow from a few characters to the maximum size.
+    for (size_t portion = 1; portion <= 1024 * 1024; portion *= 32) {
+        trickling_buffer_t buffer(json + " tail", portion);
+        std::istream input(&buffer);
+
+        EXPECT_EQ(kora::dynamic_t(array), kora::dynamic::read_json(input));
+
+        std::string rest;
+        std::getline(input, rest);
+        EXPECT_EQ("tail", rest);
+    }
+}
+
+TEST(DynamicJson, MemoryParsing) {
+    std::string json = "[1, {\"key\": \"value\"}]  tail";
+
+    size_t consumed = 0;
+    kora::dynamic_t parsed = kora::dynamic::read_json(json.data(), json.size(), &consumed);
+
+    ASSERT_TRUE(parsed.is_array());
+    EXPECT_EQ(2, parsed.as_array().size());
+    EXPECT_EQ("value", parsed.as_array()[1].as_object()["key"]);
+    EXPECT_EQ(json.size() - 4, consumed);
+
+    EXPECT_EQ(parsed, kora::dynamic::read_json(json));
+    EXPECT_EQ(parsed, kora::dynamic::read_json(json.data(), 21));
+}
+
+TEST(DynamicJson, MemoryParsingError) {
+    std::string json = "[1, 2 x]";
+
+    try {
+        kora::dynamic::read_json(json);
+        GTEST_FAIL();
+    } catch (const kora::json_parsing_error_t& e) {
+        EXPECT_EQ(6, e.offset());
+    }
+
+    std::istringstream input(json);
+
+    try {
+        kora::dynamic::read_json(input);
+        GTEST_FAIL();
+    } catch (const kora::json_parsing_error_t& e) {
+        EXPECT_EQ(6, e.offset());
+    }
+
+    // The buffer is not required to be null-terminated.
+    EXPECT_THROW(kora::dynamic::read_json(json.data(), 5), kora::json_parsing_error_t);
+}
+
+TEST(DynamicJson, DeepNesting) {
+    std::string json = "{\"b\": [[], {}, [1, [2, {\"x\": [3]}]]], \"a\": {\"c\": {\"d\": [null]}}}";
+
+    kora::dynamic_t::object_t inner;
+    inner["x"] = kora::dynamic_t::array_t({3});
+
+    kora::dynamic_t::array_t nested = {
+        kora::dynamic_t::array_t(),
+        kora::dynamic_t::object_t(),
+        kora::dynamic_t::array_t({1, kora::dynamic_t::array_t({2, inner})})
+    };
+
+    kora::dynamic_t::object_t c;
+    c["d"] = kora::dynamic_t::array_t({kora::dynamic_t::null});
+
+    kora::dynamic_t::object_t a;
+    a["c"] = c;
+
+    kora::dynamic_t::object_t expected;
+    expected["b"] = nested;
+    expected["a"] = a;
+
+    EXPECT_EQ(kora::dynamic_t(expected), kora::dynamic::read_json(json));
+}
+
+TEST(DynamicJson, FirstOfRepeatedKeysWins) {
+    kora::dynamic_t parsed = kora::dynamic::read_json("{\"b\": 1, \"a\": 2, \"b\": 3}");
+
+    ASSERT_TRUE(parsed.is_object());
+    EXPECT_EQ(2, parsed.as_object().size());
+    EXPECT_EQ(1, parsed.as_object()["b"]);
+    EXPECT_EQ(2, parsed.as_object()["a"]);
+}
+
+TEST(JsonParser, Reuse) {
+    kora::json_parser_t parser;
+
+    for (int i = 0; i < 3; ++i) {
+        std::string object_json = kora::to_json(construct_object());
+        std::istringstream input(object_json + "garbage");
+
+        check_parsed_object(parser.parse(input));
+        check_parsed_array(parser.parse(kora::to_json(construct_array())));
+
+        EXPECT_THROW(parser.parse("[1, {\"key\": [2, 3"), kora::json_parsing_error_t);
+
+        size_t consumed = 0;
+        check_parsed_object(parser.parse(object_json.data(), object_json.size(), &consumed));
+        EXPECT_EQ(object_json.size(), consumed);
+    }
+}
+
+namespace {
+    // Writes the events in a compact form: keys are followed by colons, containers by their sizes.
+    struct recording_handler_t:
+        public kora::json_handler_t
+    {
+        std::string events;
+
+        void
+        null() {
+            events += "null ";
+        }
+
+        void
+        boolean(bool value) {
+            events += value ? "true " : "false ";
+        }
+
+        void
+        integer(kora::dynamic_t::int_t value) {
+            events += "int:" + std::to_string(value) + " ";
+        }
+
+        void
+        unsigned_integer(kora::dynamic_t::uint_t value) {
+            events += "uint:" + std::to_string(value) + " ";
+        }
+
+        void
+        floating_point(kora::dynamic_t::double_t value) {
+            events += "double:" + std::to_string(value) + " ";
+        }
+
+        void
+        string(const kora::string_view_t& value) {
+            events += "\"" + value.str() + "\" ";
+        }
+
+        void
+        key(const kora::string_view_t& value) {
+            events += value.str() + ": ";
+        }
+
+        void
+        start_array() {
+            events += "[ ";
+        }
+
+        void
+        finish_array(size_t size) {
+            events += "]" + std::to_string(size) + " ";
+        }
+
+        void
+        start_object() {
+            events += "{ ";
+        }
+
+        void
+        finish_object(size_t size) {
+            events += "}" + std::to_string(size) + " ";
+        }
+    };
+
+    // Stops the reading at the first string.
+    struct stopping_handler_t:
+        public kora::json_handler_t
+    {
+        size_t values;
+
+        stopping_handler_t() :
+            values(0)
+        { }
+
+        void
+        unsigned_integer(kora::dynamic_t::uint_t) {
+            ++values;
+        }
+
+        void
+        string(const kora::string_view_t&) {
+            throw std::runtime_error("stop");
+        }
+    };
+} // namespace
+
+TEST(JsonHandler, Events) {
+    const std::string json =
+        "{\"a\": [null, true, false, -1, 2, 1.5, \"string\", {}], \"b\": {\"key\": \"key\", \"c\": []}, \"d\": 3}";
+
+    const std::string expected =
+        "{ a: [ null true false int:-1 uint:2 double:1.500000 \"string\" { }0 ]8 "
+        "b: { key: \"key\" c: [ ]0 }2 d: uint:3 }3 ";
+
+    recording_handler_t from_memory;
+    size_t consumed = 0;
+    kora::dynamic::read_json(json.data(), json.size(), from_memory, &consumed);
+    EXPECT_EQ(expected, from_memory.events);
+    EXPECT_EQ(json.size(), consumed);
+
+    std::istringstream input(json + " [1]");
+    recording_handler_t from_stream;
+    kora::dynamic::read_json(input, from_stream);
+    EXPECT_EQ(expected, from_stream.events);
+
+    // The rest of the stream is left for the next call.
+    recording_handler_t next;
+    kora::dynamic::read_json(input, next);
+    EXPECT_EQ("[ uint:1 ]1 ", next.events);
+
+    // Default implementations ignore the events.
+    kora::json_handler_t ignoring;
+    kora::dynamic::read_json(json.data(), json.size(), ignoring);
+}
+
+TEST(JsonHandler, ParsingError) {
+    recording_handler_t handler;
+
+    try {
+        kora::dynamic::read_json("[1, {\"key\" 2}]", 15, handler);
+        GTEST_FAIL();
+    } catch (const kora::json_parsing_error_t& e) {
+        EXPECT_EQ(11, e.offset());
+    }
+
+    EXPECT_EQ("[ uint:1 { key: ", handler.events);
+}
+
+TEST(JsonHandler, HandlerStopsReading) {
+    std::istringstream input("[1, 2, \"stop\", 3] tail");
+
+    stopping_handler_t handler;
+    EXPECT_THROW(kora::dynamic::read_json(input, handler), std::runtime_error);
+    EXPECT_EQ(2, handler.values);
+    EXPECT_FALSE(input.bad());
+
+    std::string rest;
+    std::getline(input, rest);
+    EXPECT_EQ(", 3] tail", rest);
+}
+
+TEST(JsonParser, ReuseWithHandler) {
+    kora::json_parser_t parser;
+
+    for (int i = 0; i < 3; ++i) {
+        const std::string broken = "[1, {\"key\": [2, 3";
+        recording_handler_t handler;
+        EXPECT_THROW(parser.parse(broken.data(), broken.size(), handler), kora::json_parsing_error_t);
+
+        const std::string stop = "{\"a\": [\"stop\"]}";
+        stopping_handler_t stopping;
+        EXPECT_THROW(parser.parse(stop.data(), stop.size(), stopping), std::runtime_error);
+
+        recording_handler_t next;
+        std::istringstream input("{\"a\": [1]}");
+        parser.parse(input, next);
+        EXPECT_EQ("{ a: [ uint:1 ]1 }1 ", next.events);
+
+        EXPECT_EQ(kora::dynamic_t::array_t(1, 2), parser.parse("[2]"));
+    }
+}
+
+TEST(JsonProjection, SelectsPaths) {
+    const std::string json =
+        "{\"meta\": {\"id\": 7, \"name\": \"a rather long name which is skipped\"},"
+        " \"items\": [{\"price\": 1.5, \"tags\": [1]}, {\"count\": 2}, {\"price\": {\"value\": 3}}, 4],"
+        " \"rest\": [[{}], \"string\"]}";
+
+    const kora::json_projection_t projection({"$.meta.id", "items[*].price", "missing.key"});
+
+    kora::dynamic_t::object_t expected;
+    expected["meta"] = kora::dynamic_t::object_t({{"id", 7}});
+    expected["items"] = kora::dynamic_t::array_t({
+        kora::dynamic_t::object_t({{"price", 1.5}}),
+        kora::dynamic_t::null,
+        kora::dynamic_t::object_t({{"price", kora::dynamic_t::object_t({{"value", 3}})}})
+    });
+
+    size_t consumed = 0;
+    EXPECT_EQ(kora::dynamic_t(expected), kora::dynamic::read_json(json.data(), json.size(), projection, &consumed));
+    EXPECT_EQ(json.size(), consumed);
+
+    std::istringstream input(json + " [1]");
+    EXPECT_EQ(kora::dynamic_t(expected), kora::dynamic::read_json(input, projection));
+    EXPECT_EQ(kora::dynamic_t::array_t(1, 1), kora::dynamic::read_json(input));
+}
+
+TEST(JsonProjection, Wildcards) {
+    const std::string json = "[{\"a\": 1, \"b\": {\"c\": 2, \"d\": 3}}, {\"b\": {\"d\": 4}}, [5, 6]]";
+
+    // Explicit keys and indexes get the paths of the wildcards.
+    const kora::json_projection_t projection({"[0].b.c", "[*].*.d", "[2][1]"});
+
+    kora::dynamic_t::array_t expected = {
+        kora::dynamic_t::object_t({{"b", kora::dynamic_t::object_t({{"c", 2}, {"d", 3}})}}),
+        kora::dynamic_t::object_t({{"b", kora::dynamic_t::object_t({{"d", 4}})}}),
+        kora::dynamic_t::array_t({kora::dynamic_t::null, 6})
+    };
+
+    EXPECT_EQ(kora::dynamic_t(expected), kora::dynamic::read_json(json.data(), json.size(), projection));
+
+    // Selecting a value selects it whole, whatever the other paths are.
+    const kora::json_projection_t whole({"[0].b", "[0].b.c", "[1]"});
+
+    expected = {
+        kora::dynamic_t::object_t({{"b", kora::dynamic_t::object_t({{"c", 2}, {"d", 3}})}}),
+        kora::dynamic_t::object_t({{"b", kora::dynamic_t::object_t({{"d", 4}})}})
+    };
+
+    EXPECT_EQ(kora::dynamic_t(expected), kora::dynamic::read_json(json.data(), json.size(), whole));
+
+    EXPECT_EQ(kora::dynamic::read_json(json), kora::dynamic::read_json(json.data(), json.size(),
+        kora::json_projection_t({"$"})));
+    EXPECT_TRUE(kora::dynamic::read_json(json.data(), json.size(), kora::json_projection_t({"[3]"})).is_null());
+    EXPECT_TRUE(kora::dynamic::read_json(json.data(), json.size(), kora::json_projection_t({"a"})).is_null());
+}
+
+TEST(JsonProjection, IncorrectPaths) {
+    const char *paths[] = {"a..b", "a[", "a[]", "a[1x]", "a.", "$a", "a]", "[0]b"};
+    const size_t offsets[] = {2, 1, 1, 3, 2, 1, 1, 3};
+
+    for (size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); ++i) {
+        try {
+            kora::json_projection_t projection({paths[i]});
+            ADD_FAILURE() << paths[i];
+        } catch (const kora::json_path_error_t& e) {
+            EXPECT_EQ(offsets[i], e.offset()) << paths[i];
+        }
+    }
+}
+
+TEST(JsonParser, ReuseWithProjection) {
+    kora::json_parser_t parser;
+    const kora::json_projection_t projection({"a"});
+
+    for (int i = 0; i < 3; ++i) {
+        const std::string broken = "{\"a\": [1, 2";
+        EXPECT_THROW(parser.parse(broken.data(), broken.size(), projection), kora::json_parsing_error_t);
+
+        const std::string json = "{\"b\": [], \"a\": [1, 2]}";
+        EXPECT_EQ(kora::dynamic::read_json("{\"a\": [1, 2]}"), parser.parse(json.data(), json.size(), projection));
+
+        std::istringstream input(json);
+        EXPECT_EQ(kora::dynamic::read_json("{\"a\": [1, 2]}"), parser.parse(input, projection));
+    }
+}
+
+TEST(LazyJson, KeepsDeepContainersAsText) {
+    const std::string json = "{\"id\": 7, \"items\": [1,  {\"a\": [2]}], \"meta\": {\"b\" : null}, \"empty\": []} [1]";
+
+    size_t consumed = 0;
+    const kora::dynamic_t value = kora::dynamic::read_lazy_json(json, 1, &consumed);
+
+    // The space before the rest is consumed.
+    EXPECT_EQ(json.size() - 3, consumed);
+    EXPECT_TRUE(value.json_text().empty());
+
+    const kora::dynamic_t::object_t& object = value.as_object();
+    EXPECT_EQ(7, object.at("id"));
+    EXPECT_EQ("[1,  {\"a\": [2]}]", object.at("items").json_text());
+    EXPECT_EQ("{\"b\" : null}", object.at("meta").json_text());
+    EXPECT_EQ("[]", object.at("empty").json_text());
+
+    EXPECT_TRUE(object.at("items").is_array());
+    EXPECT_FALSE(object.at("items").is_object());
+    EXPECT_TRUE(object.at("meta").is_object());
+
+    // The text is written as is.
+    const std::string written = kora::to_json(value);
+    EXPECT_NE(std::string::npos, written.find("[1,  {\"a\": [2]}]"));
+    EXPECT_EQ(kora::dynamic::read_json(json), kora::dynamic::read_json(written));
+
+    EXPECT_EQ(kora::dynamic::read_json(json), value);
+    EXPECT_EQ(kora::hash_value(kora::dynamic::read_json(json)), kora::hash_value(value));
+
+    const kora::dynamic_t whole = kora::dynamic::read_lazy_json(json.data(), json.size(), 0);
+    EXPECT_EQ(json.substr(0, json.size() - 4), whole.json_text());
+    EXPECT_EQ(json.substr(0, json.size() - 4), kora::to_json(whole));
+    EXPECT_EQ(value, whole);
+
+    const kora::dynamic_t deep = kora::dynamic::read_lazy_json(json, 2);
+    EXPECT_TRUE(deep.as_object().at("items").json_text().empty());
+    EXPECT_EQ("{\"a\": [2]}", deep.as_object().at("items").as_array()[1].json_text());
+
+    EXPECT_THROW(kora::dynamic::read_lazy_json("{\"a\": [1, }", 1), kora::json_parsing_error_t);
+}
+
+TEST(LazyJson, ParsesOnAccess) {
+    const kora::dynamic_t value = kora::dynamic::read_lazy_json("[{\"a\": [1, 2]}, [3]]", 1);
+
+    const kora::dynamic_t& first = value.as_array()[0];
+    EXPECT_EQ(kora::dynamic_t::array_t({1, 2}), first.as_object().at("a"));
+    EXPECT_EQ((std::vector<int>{3}), value.as_array()[1].to<std::vector<int>>());
+    EXPECT_EQ("[3]", kora::to_json(value.as_array()[1]));
+    EXPECT_EQ("[\n  3\n]", kora::to_pretty_json(value.as_array()[1], 2));
+
+    // Const access keeps the text, and modifications replace it with the parsed value.
+    EXPECT_EQ("{\"a\": [1, 2]}", first.json_text());
+
+    kora::dynamic_t item = first;
+    item.as_object()["b"] = true;
+    EXPECT_TRUE(item.json_text().empty());
+    EXPECT_EQ("{\"a\":[1,2],\"b\":true}", kora::to_json(item));
+    EXPECT_EQ("{\"a\": [1, 2]}", value.as_array()[0].json_text());
+}
+
+TEST(LazyJson, FromJsonText) {
+    const std::shared_ptr<const std::string> buffer = std::make_shared<const std::string>("[1, 2] {\"a\": } [1, 2]");
+
+    const kora::dynamic_t first = kora::dynamic_t::from_json_text(buffer, kora::string_view_t(buffer->data(), 6));
+    const kora::dynamic_t last = kora::dynamic_t::from_json_text(buffer, kora::string_view_t(buffer->data() + 15, 6));
+
+    EXPECT_EQ(kora::dynamic_t(kora::dynamic_t::array_t({1, 2})), first);
+    EXPECT_EQ(first, last);
+    EXPECT_EQ(first, kora::dynamic_t::from_json_text(buffer, first.json_text()));
+    EXPECT_EQ(kora::hash_value(kora::dynamic_t(kora::dynamic_t::array_t({1, 2}))), kora::hash_value(first));
+
+    // The whole text is checked when the value is created.
+    EXPECT_THROW(
+        kora::dynamic_t::from_json_text(buffer, kora::string_view_t(buffer->data() + 7, 7)),
+        kora::json_parsing_error_t
+    );
+    EXPECT_THROW(
+        kora::dynamic_t::from_json_text(buffer, kora::string_view_t(buffer->data(), 14)),
+        kora::json_parsing_error_t
+    );
+
+    EXPECT_THROW(kora::dynamic_t::from_json_text(buffer, "1"), kora::json_parsing_error_t);
+    EXPECT_THROW(kora::dynamic_t::from_json_text(buffer, ""), kora::json_parsing_error_t);
+    EXPECT_THROW(kora::dynamic_t::from_json_text(buffer, "{} x"), kora::json_parsing_error_t);
+    EXPECT_THROW(kora::dynamic_t::from_json_text(buffer, kora::string_view_t("[]\0", 3)), kora::json_parsing_error_t);
+}
+
+TEST(RawJson, WrittenAsIs) {
+    const kora::dynamic::raw_json_t flags("  {\"beta\": true, \"limits\": [1,2.50]}\n");
+
+    kora::dynamic_t::object_t response;
+    response["flags"] = flags;
+    response["id"] = 1;
+
+    EXPECT_EQ("{\"flags\":{\"beta\": true, \"limits\": [1,2.50]},\"id\":1}", kora::to_json(response));
+
+    std::ostringstream stream;
+    kora::write_json(stream, kora::dynamic_t::array_t({flags, flags}));
+    EXPECT_EQ("[{\"beta\": true, \"limits\": [1,2.50]},{\"beta\": true, \"limits\": [1,2.50]}]", stream.str());
+
+    // The text is shared by the values and parsed if they are accessed.
+    const kora::dynamic_t value = flags;
+    EXPECT_EQ(flags.json()->data() + 2, value.json_text().data());
+    EXPECT_TRUE(value.as_object().at("beta").as_bool());
+    EXPECT_EQ(kora::dynamic::read_json(*flags.json()), value);
+
+    // Large fragments are written to the stream directly.
+    const std::string large = "[\"" + std::string(10000, 'x') + "\"]";
+    stream.str("");
+    kora::write_json(stream, kora::dynamic_t::array_t({1, kora::dynamic::raw_json_t(large), 2}));
+    EXPECT_EQ("[1," + large + ",2]", stream.str());
+
+    // The separators are put before raw values as before any other value.
+    kora::dynamic_t::object_t nested;
+    nested["n"] = 0.5;
+    nested["null"] = kora::dynamic_t::array_t({kora::dynamic::raw_json_t("{\"n\":null}"), 1.5, kora::dynamic_t::null});
+    EXPECT_EQ("{\"n\":0.5,\"null\":[{\"n\":null},1.5,null]}", kora::to_json(nested));
+    EXPECT_EQ(
+        "{\n \"n\": 0.5,\n \"null\": [\n  {\n   \"n\": null\n  },\n  1.5,\n  null\n ]\n}",
+        kora::to_pretty_json(nested, 1)
+    );
+
+    EXPECT_THROW(kora::dynamic_t(kora::dynamic::raw_json_t("true")), kora::json_parsing_error_t);
+    EXPECT_THROW(kora::dynamic_t(kora::dynamic::raw_json_t(" ")), kora::json_parsing_error_t);
+    EXPECT_THROW(kora::dynamic::raw_json_t("{oops"), kora::json_parsing_error_t);
+    EXPECT_THROW(kora::dynamic::raw_json_t("{} x"), kora::json_parsing_error_t);
+}
+
 namespace {
     void
     check_parsing_error(const std::string& data) {
         std::istringstream input(data);
         EXPECT_THROW(kora::dynamic::read_json(input), kora::json_parsing_error_t);
+        EXPECT_THROW(kora::dynamic::read_json(data), kora::json_parsing_error_t);
     }
 }
 
@@ -315,6 +883,27 @@ TEST(DynamicJson, PrettyJsonToString) {
     return;
 }
 
+TEST(DynamicJson, LargeJsonToStreamAndString) {
+    kora::dynamic_t::array_t array;
+
+    for (int i = 0; i < 1000; ++i) {
+        array.emplace_back(construct_object());
+    }
+
+    kora::dynamic_t value(array);
+
+    std::ostringstream simple_output;
+    kora::write_json(simple_output, value);
+    EXPECT_EQ(simple_output.str(), kora::to_json(value));
+
+    std::ostringstream pretty_output;
+    kora::write_pretty_json(pretty_output, value, 2);
+    EXPECT_EQ(pretty_output.str(), kora::to_pretty_json(value, 2));
+
+    EXPECT_EQ(value, kora::dynamic::read_json(simple_output.str()));
+    EXPECT_EQ(value, kora::dynamic::read_json(pretty_output.str()));
+}
+
 TEST(DynamicJson, ValuesToStream) {
     std::ostringstream output;
 
@@ -358,6 +947,56 @@ TEST(DynamicJson, ValuesToStream) {
     EXPECT_EQ("{}", output.str());
 }
 
+TEST(DynamicJson, ShortestDoubles) {
+    const std::pair<double, const char*> cases[] = {
+        {0.0, "0.0"},
+        {-0.0, "-0.0"},
+        {1.0, "1.0"},
+        {-5.0, "-5.0"},
+        {0.1, "0.1"},
+        {0.1 + 0.2, "0.30000000000000004"},
+        {123456.789, "123456.789"},
+        {1e20, "100000000000000000000.0"},
+        {1e21, "1e21"},
+        {0.000001, "0.000001"},
+        {1.5e-7, "1.5e-7"},
+        {5e-324, "5e-324"},
+        {1.7976931348623157e308, "1.7976931348623157e308"}
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+        EXPECT_EQ(cases[i].second, kora::to_json(cases[i].first));
+        EXPECT_EQ(cases[i].second, kora::to_pretty_json(cases[i].first));
+
+        std::ostringstream output;
+        output << kora::dynamic_t(cases[i].first);
+        EXPECT_EQ(cases[i].second, output.str());
+    }
+
+    // Any finite double is read back exactly.
+    std::mt19937_64 generator(42);
+    kora::dynamic_t::array_t numbers;
+
+    while (numbers.size() < 10000) {
+        const uint64_t bits = generator();
+
+        double number;
+        std::memcpy(&number, &bits, sizeof(number));
+
+        if (std::isfinite(number)) {
+            numbers.push_back(number);
+        }
+    }
+
+    const kora::dynamic_t parsed = kora::dynamic::read_json(kora::to_json(numbers));
+
+    for (size_t i = 0; i < numbers.size(); ++i) {
+        const double expected = numbers[i].as_double();
+        const double actual = parsed.as_array()[i].as_double();
+        EXPECT_EQ(0, std::memcmp(&expected, &actual, sizeof(expected))) << kora::to_json(expected);
+    }
+}
+
 TEST(DynamicJson, ObjectToStream) {
     std::ostringstream output;
     output << construct_object();
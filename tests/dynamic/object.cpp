@@ -23,6 +23,9 @@ along with this program. If not, see <http://www.gnu.org/licenses/>.
 
 #include "kora/dynamic.hpp"
 
+#include <set>
+#include <type_traits>
+
 TEST(DynamicObject, Constructors) {
     kora::dynamic_t::object_t obj1;
     EXPECT_TRUE(obj1.empty());
@@ -108,3 +111,313 @@ TEST(DynamicObject, AtRvalue) {
 
     EXPECT_EQ(kora::dynamic_t::object_t(), obj2);
 }
+
+TEST(DynamicObject, InsertAndFind) {
+    kora::dynamic_t::object_t object;
+
+    const char *keys[] = {"m", "b", "z", "a", "q", "c"};
+
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); ++i) {
+        auto result = object.insert(std::make_pair(std::string(keys[i]), kora::dynamic_t(i)));
+        EXPECT_TRUE(result.second);
+        EXPECT_EQ(keys[i], result.first->first);
+    }
+
+    auto result = object.insert(std::make_pair(std::string("q"), kora::dynamic_t(100)));
+    EXPECT_FALSE(result.second);
+    EXPECT_EQ(4, result.first->second);
+
+    EXPECT_EQ(6, object.size());
+
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); ++i) {
+        ASSERT_NE(object.end(), object.find(keys[i]));
+        EXPECT_EQ(i, object.find(keys[i])->second);
+    }
+
+    EXPECT_EQ(object.end(), object.find("x"));
+    EXPECT_EQ(0, object.count("x"));
+    ASSERT_THROW(object.at("x"), std::out_of_range);
+}
+
+TEST(DynamicObject, RangeConstructorKeepsFirstValue) {
+    std::vector<kora::dynamic_t::object_t::value_type> items;
+    items.push_back(std::make_pair(std::string("b"), kora::dynamic_t(1)));
+    items.push_back(std::make_pair(std::string("a"), kora::dynamic_t(2)));
+    items.push_back(std::make_pair(std::string("b"), kora::dynamic_t(3)));
+
+    kora::dynamic_t::object_t object(items.begin(), items.end());
+
+    EXPECT_EQ(2, object.size());
+    EXPECT_EQ(1, object.at("b"));
+    EXPECT_EQ(2, object.at("a"));
+}
+
+TEST(DynamicObject, Erase) {
+    kora::dynamic_t::object_t object = {{"a", 1}, {"b", 2}, {"c", 3}};
+
+    EXPECT_EQ(1, object.erase("b"));
+    EXPECT_EQ(0, object.erase("b"));
+    EXPECT_EQ(2, object.size());
+
+    object.erase(object.find("a"));
+    EXPECT_EQ(1, object.size());
+    EXPECT_EQ(3, object.at("c"));
+
+    object.erase(object.begin(), object.end());
+    EXPECT_TRUE(object.empty());
+}
+
+TEST(DynamicObject, ConstantKeys) {
+    typedef kora::dynamic_t::object_t object_t;
+
+    static_assert(std::is_same<object_t::value_type, std::pair<const std::string, kora::dynamic_t>>::value,
+                  "object keys must be constant");
+    static_assert(std::is_const<std::remove_reference<decltype(object_t::iterator()->first)>::type>::value,
+                  "object keys must not be modifiable through iterators");
+    static_assert(std::is_same<object_t::reference, std::pair<const std::string&, kora::dynamic_t&>>::value,
+                  "iterators must refer to the stored keys and values");
+
+    object_t object = {{"a", 1}, {"b", 2}};
+
+    object_t::iterator it = object.find("b");
+    it->second = 3;
+    EXPECT_EQ(3, object.at("b"));
+
+    object_t::const_iterator const_it = it;
+    EXPECT_TRUE(const_it == it);
+    EXPECT_EQ("b", const_it->first);
+    EXPECT_EQ(1, const_it - object.cbegin());
+
+    // The references point into the object.
+    auto&& item_ref = *object.begin();
+    item_ref.second = 0;
+    EXPECT_EQ(0, object.at("a"));
+    EXPECT_EQ(&object.at("a"), &object.begin()->second);
+
+    const object_t::value_type copy = *const_it;
+    EXPECT_EQ("b", copy.first);
+    EXPECT_EQ(3, copy.second);
+
+    const object_t::value_type item("c", 4);
+    EXPECT_TRUE(object.insert(item).second);
+    EXPECT_TRUE(object.insert(std::make_pair("d", 5)).second);
+    EXPECT_EQ(4, object.size());
+    EXPECT_EQ(5, object.at("d"));
+}
+
+TEST(DynamicObject, IndexingInsertsNull) {
+    kora::dynamic_t::object_t object;
+    object["b"] = 1;
+
+    EXPECT_TRUE(object["a"].is_null());
+    EXPECT_EQ(2, object.size());
+    EXPECT_EQ(1, object["b"]);
+}
+
+TEST(DynamicObject, ComparisonWithMap) {
+    std::map<std::string, kora::dynamic_t> map;
+    map["a"] = 1;
+    map["b"] = "x";
+
+    kora::dynamic_t::object_t object(map);
+    EXPECT_TRUE(object == map);
+    EXPECT_TRUE(map == object);
+
+    object["c"] = 5;
+    EXPECT_TRUE(object != map);
+    EXPECT_TRUE(map != object);
+
+    map["c"] = 6;
+    EXPECT_NE(object, map);
+}
+
+namespace {
+
+std::string
+make_key(size_t i) {
+    return "key-" + std::to_string(i * 7919 % 1000);
+}
+
+} // namespace
+
+TEST(DynamicObject, LargeObject) {
+    kora::dynamic_t::object_t object;
+
+    for (size_t i = 0; i < 1000; ++i) {
+        object[make_key(i)] = i;
+    }
+
+    EXPECT_EQ(1000, object.size());
+    EXPECT_FALSE(object.insert(std::make_pair(make_key(10), kora::dynamic_t(0))).second);
+
+    for (size_t i = 0; i < 1000; ++i) {
+        ASSERT_NE(object.end(), object.find(make_key(i)));
+        EXPECT_EQ(i, object.at(make_key(i)));
+    }
+
+    EXPECT_EQ(object.end(), object.find("key-1000"));
+    EXPECT_EQ(0, object.count("key-1000"));
+
+    std::map<std::string, kora::dynamic_t> map(object.begin(), object.end());
+    EXPECT_EQ(1000, map.size());
+    EXPECT_EQ(map, object);
+    EXPECT_EQ(kora::dynamic_t::object_t(map), object);
+}
+
+TEST(DynamicObject, LargeObjectRangeConstructorKeepsFirstValue) {
+    std::vector<kora::dynamic_t::object_t::value_type> items;
+
+    for (size_t i = 0; i < 2000; ++i) {
+        items.push_back(std::make_pair(make_key(i % 1000), kora::dynamic_t(i)));
+    }
+
+    kora::dynamic_t::object_t object(items.begin(), items.end());
+
+    EXPECT_EQ(1000, object.size());
+
+    for (size_t i = 0; i < 1000; ++i) {
+        EXPECT_EQ(i, object.at(make_key(i)));
+    }
+}
+
+TEST(DynamicObject, LargeObjectErase) {
+    kora::dynamic_t::object_t object;
+
+    for (size_t i = 0; i < 1000; ++i) {
+        object[make_key(i)] = i;
+    }
+
+    // Erase every item with odd value while iterating.
+    for (auto it = object.begin(); it != object.end();) {
+        if (it->second.as_uint() % 2 == 1) {
+            it = object.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    EXPECT_EQ(1, object.erase(make_key(0)));
+    EXPECT_EQ(0, object.erase(make_key(0)));
+    EXPECT_EQ(499, object.size());
+
+    for (size_t i = 1; i < 1000; ++i) {
+        EXPECT_EQ(i % 2 == 0 ? 1 : 0, object.count(make_key(i)));
+    }
+
+    object.erase(object.begin() + 10, object.end());
+    EXPECT_EQ(10, object.size());
+
+    for (auto it = object.begin(); it != object.end(); ++it) {
+        EXPECT_EQ(it->second, object.at(it->first));
+    }
+
+    object.clear();
+    object["a"] = 1;
+    EXPECT_EQ(1, object.at("a"));
+}
+
+TEST(DynamicObject, LargeObjectEraseRange) {
+    kora::dynamic_t::object_t object;
+
+    for (size_t i = 100; i-- > 0;) {
+        object[std::to_string(i)] = i;
+    }
+
+    // The items added after the object has grown large are appended.
+    EXPECT_EQ("0", (object.end() - 1)->first);
+
+    std::set<std::string> erased;
+
+    // The gap is narrower than the tail, so the last items fill it.
+    for (auto it = object.begin() + 10; it != object.begin() + 20; ++it) {
+        erased.insert(it->first);
+    }
+
+    const std::string moved = (object.end() - 10)->first;
+    auto it = object.erase(object.begin() + 10, object.begin() + 20);
+    EXPECT_EQ(moved, it->first);
+
+    // The gap is wider than the rest of the tail.
+    for (it = object.begin() + 80; it != object.begin() + 85; ++it) {
+        erased.insert(it->first);
+    }
+
+    it = object.erase(object.begin() + 80, object.begin() + 85);
+    EXPECT_EQ(80, it - object.begin());
+
+    for (it = object.begin() + 75; it != object.end(); ++it) {
+        erased.insert(it->first);
+    }
+
+    it = object.erase(object.begin() + 75, object.end());
+    EXPECT_TRUE(it == object.end());
+    EXPECT_EQ(75, object.size());
+
+    for (size_t i = 0; i < 100; ++i) {
+        const std::string key = std::to_string(i);
+        EXPECT_EQ(erased.count(key) ? 0 : 1, object.count(key));
+    }
+
+    for (it = object.begin(); it != object.end(); ++it) {
+        EXPECT_EQ(it->second, object.at(it->first));
+    }
+}
+
+TEST(DynamicObject, LargeObjectEraseFromCopies) {
+    kora::dynamic_t::object_t object;
+
+    for (size_t i = 0; i < 100; ++i) {
+        object[make_key(i)] = i;
+    }
+
+    kora::dynamic_t::object_t copy(object);
+    kora::dynamic_t::object_t temporary(object);
+    kora::dynamic_t::object_t moved(std::move(temporary));
+
+    // Copies of the objects of a document are made item by item.
+    kora::document_t document;
+    const kora::dynamic_t in_document = document.make_object(object);
+    kora::dynamic_t document_copy = in_document;
+
+    for (size_t i = 0; i < 100; i += 2) {
+        EXPECT_EQ(1, copy.erase(make_key(i)));
+        EXPECT_EQ(1, moved.erase(make_key(i)));
+        EXPECT_EQ(1, document_copy.as_object().erase(make_key(i)));
+    }
+
+    for (size_t i = 0; i < 100; ++i) {
+        EXPECT_EQ(1, object.count(make_key(i)));
+        EXPECT_EQ(i % 2, copy.count(make_key(i)));
+        EXPECT_EQ(i % 2, moved.count(make_key(i)));
+        EXPECT_EQ(i % 2, document_copy.as_object().count(make_key(i)));
+    }
+}
+
+TEST(DynamicObject, LargeObjectComparison) {
+    kora::dynamic_t::object_t forward;
+    kora::dynamic_t::object_t backward;
+    kora::dynamic_t::object_t small;
+
+    for (size_t i = 0; i < 100; ++i) {
+        forward[make_key(i)] = i;
+        backward[make_key(99 - i)] = 99 - i;
+    }
+
+    for (size_t i = 0; i < 10; ++i) {
+        small[make_key(i)] = i;
+    }
+
+    EXPECT_EQ(forward, backward);
+    EXPECT_NE(forward, small);
+
+    backward.erase(make_key(50));
+    EXPECT_NE(forward, backward);
+
+    // The object remains hashed after erasing most of the keys.
+    for (size_t i = 10; i < 100; ++i) {
+        forward.erase(make_key(i));
+    }
+
+    EXPECT_EQ(small, forward);
+    EXPECT_EQ(forward, small);
+}